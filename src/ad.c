@@ -1,114 +1,241 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 
 #include "ad.h"
+#include "compiler.h"
+#include "intern.h"
 #include "utils.h"
+#include "lexer.h"
+#include "prelude.inc"
 
-Ret ret;
-Domain *symTable;
-Symbol *crtFn;
+typedef struct Binding
+{
+	int name;	 // -1 for an empty slot
+	Symbol *top; // the innermost symbol with this name or NULL if there is none now
+} Binding;
 
-Domain *addDomain()
+// the interned names are small consecutive ints, so they are spread by a multiplicative hash
+static inline unsigned slotOf(int name, unsigned cap)
 {
-	ILOG("creates a new domain\n");
-	Domain *d = (Domain *)safeAlloc(sizeof(Domain));
-	d->parent = symTable;
-	d->symbols = NULL;
-	symTable = d;
-	return d;
+	return ((unsigned)name * 2654435761u) & (cap - 1);
 }
 
-void delSymbols(Symbol *list);
-
-void delSymbol(Symbol *s)
+// returns the binding of a name or NULL if the name was never bound
+static Binding *findBinding(Bindings *b, int name)
 {
-	ILOG("\tdeletes the symbol %s\n", s->name);
-	if (s->kind == KIND_FN)
+	if (!b->cap)
+		return NULL;
+	for (unsigned i = slotOf(name, b->cap);; i = (i + 1) & (b->cap - 1))
 	{
-		delSymbols(s->args);
+		if (b->slots[i].name == name)
+			return &b->slots[i];
+		if (b->slots[i].name < 0)
+			return NULL;
 	}
-	free(s);
 }
 
-void delSymbols(Symbol *list)
+static void growBindings(Bindings *b)
 {
-	for (Symbol *s1 = list, *s2; s1; s1 = s2)
+	unsigned cap = b->cap ? b->cap * 2 : 256;
+	Binding *slots = (Binding *)safeAlloc(cap * sizeof(Binding));
+	for (unsigned i = 0; i < cap; i++)
+		slots[i].name = -1;
+	for (unsigned j = 0; j < b->cap; j++)
 	{
-		s2 = s1->next;
-		delSymbol(s1);
+		if (b->slots[j].name < 0)
+			continue;
+		unsigned i = slotOf(b->slots[j].name, cap);
+		while (slots[i].name >= 0)
+			i = (i + 1) & (cap - 1);
+		slots[i] = b->slots[j];
 	}
+	free(b->slots);
+	b->slots = slots;
+	b->cap = cap;
 }
 
-void delDomain()
+// returns the binding of a name, adding it if the name is new
+// the names whose symbols were all deleted keep their slots, so there are no tombstones
+static Binding *bindingOf(Bindings *b, int name)
 {
-	ILOG("deletes the current domain\n");
-	Domain *parent = symTable->parent;
-	delSymbols(symTable->symbols);
-	free(symTable);
-	symTable = parent;
-	ILOG("returns to the parent domain\n");
+	Binding *e = findBinding(b, name);
+	if (e)
+		return e;
+	// keeps the load factor under 1/2
+	if ((unsigned)(b->n + 1) * 2 > b->cap)
+		growBindings(b);
+	unsigned i = slotOf(name, b->cap);
+	while (b->slots[i].name >= 0)
+		i = (i + 1) & (b->cap - 1);
+	b->n++;
+	b->slots[i] = (Binding){name, NULL};
+	return &b->slots[i];
 }
 
-Symbol *searchInList(Symbol *list, const char *name)
+void freeBindings(Bindings *b)
 {
-	for (Symbol *s = list; s; s = s->next)
-	{
-		if (!strcmp(s->name, name))
-			return s;
-	}
-	return NULL;
+	free(b->slots);
+	*b = (Bindings){0};
 }
 
-Symbol *searchInCurrentDomain(const char *name)
+// ********************* arena *******************
+
+// the size of a chunk, enough for thousands of symbols
+#define CHUNK_SIZE (64 * 1024)
+
+typedef struct Chunk Chunk;
+struct Chunk
 {
-	return searchInList(symTable->symbols, name);
+	Chunk *prev;
+	size_t cap;
+	_Alignas(max_align_t) char mem[];
+};
+
+ArenaMark arenaMark(Arena *a)
+{
+	return (ArenaMark){a->chunk, a->used};
 }
 
-Symbol *searchSymbol(const char *name)
+void *arenaAlloc(Arena *a, size_t size)
 {
-	for (Domain *d = symTable; d; d = d->parent)
+	size = (size + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1);
+	if (!a->chunk || a->used + size > a->chunk->cap)
 	{
-		Symbol *s = searchInList(d->symbols, name);
-		if (s)
-			return s;
+		Chunk *chunk = a->spare;
+		if (chunk && size <= chunk->cap)
+		{
+			a->spare = NULL;
+		}
+		else
+		{
+			size_t cap = size > CHUNK_SIZE ? size : CHUNK_SIZE;
+			chunk = (Chunk *)safeAlloc(sizeof(Chunk) + cap);
+			chunk->cap = cap;
+		}
+		chunk->prev = a->chunk;
+		a->chunk = chunk;
+		a->used = 0;
 	}
-	return NULL;
+	void *p = a->chunk->mem + a->used;
+	a->used += size;
+	return p;
+}
+
+void arenaRewind(Arena *a, ArenaMark mark)
+{
+	while (a->chunk != mark.chunk)
+	{
+		Chunk *prev = a->chunk->prev;
+		// the last freed chunk is kept, so a domain which is added and deleted repeatedly does not call malloc
+		if (!a->spare && a->chunk->cap == CHUNK_SIZE)
+		{
+			a->spare = a->chunk;
+		}
+		else
+		{
+			free(a->chunk);
+		}
+		a->chunk = prev;
+	}
+	a->used = mark.used;
+}
+
+void arenaFree(Arena *a)
+{
+	arenaRewind(a, (ArenaMark){NULL, 0});
+	free(a->spare);
+	*a = (Arena){0};
+}
+
+// the symbols are deleted in the reverse order of their adding, so s is always the innermost one
+static void unbind(Compiler *c, Symbol *s)
+{
+	findBinding(&c->names, s->name)->top = s->shadowed;
 }
 
-Symbol *createSymbol(const char *name, int kind)
+Domain *addDomain(Compiler *c)
 {
-	Symbol *s = (Symbol *)safeAlloc(sizeof(Symbol));
+	ArenaMark mark = arenaMark(&c->symArena);
+	Domain *d = (Domain *)arenaAlloc(&c->symArena, sizeof(Domain));
+	d->mark = mark;
+	d->parent = c->symTable;
+	d->symbols = NULL;
+	d->depth = c->symTable ? c->symTable->depth + 1 : 0;
+	c->symTable = d;
+	return d;
+}
+
+void delDomain(Compiler *c)
+{
+	Domain *d = c->symTable;
+	for (Symbol *s = d->symbols; s; s = s->next)
+		unbind(c, s);
+	c->symTable = d->parent;
+	// the domain, its symbols and their args are all after its mark in the arena
+	arenaRewind(&c->symArena, d->mark);
+}
+
+// ********************* prelude *******************
+
+void internPrelude(Compiler *c)
+{
+	internSeed(c->strings, preludeNames, preludeLens, preludeHashes, N_PRELUDE_NAMES);
+}
+
+// the predefined functions are outside all the domains, so they are found by their ids, without bindings
+static inline Symbol *preludeSymbol(int name)
+{
+	return name < N_PRELUDE_FNS ? (Symbol *)&preludeFns[name] : NULL;
+}
+
+Symbol *searchInCurrentDomain(Compiler *c, int name)
+{
+	Binding *e = findBinding(&c->names, name);
+	if (e && e->top && e->top->depth == c->symTable->depth)
+		return e->top;
+	// the globals cannot redefine the predefined functions
+	return c->symTable->parent ? NULL : preludeSymbol(name);
+}
+
+Symbol *searchSymbol(Compiler *c, int name)
+{
+	Binding *e = findBinding(&c->names, name);
+	if (e && e->top)
+		return e->top;
+	// a function job sees the globals of its parent, but only the ones defined until its own header, like the serial compilation
+	if (c->outerNames && (e = findBinding(c->outerNames, name)) && e->top && e->top->order <= c->fnOrder)
+		return e->top;
+	return preludeSymbol(name);
+}
+
+Symbol *createSymbol(Compiler *c, int name, int kind)
+{
+	Symbol *s = (Symbol *)arenaAlloc(&c->symArena, sizeof(Symbol));
 	s->name = name;
 	s->kind = kind;
 	return s;
 }
 
-Symbol *addSymbol(const char *name, int kind)
+Symbol *addSymbol(Compiler *c, int name, int kind)
 {
-	ILOG("\tadds symbol %s\n", name);
-	Symbol *s = createSymbol(name, kind);
-	s->next = symTable->symbols;
-	symTable->symbols = s;
+	Symbol *s = createSymbol(c, name, kind);
+	s->order = c->nSymbols++;
+	s->depth = c->symTable->depth;
+	Binding *e = bindingOf(&c->names, name);
+	s->shadowed = e->top;
+	e->top = s;
+	s->next = c->symTable->symbols;
+	c->symTable->symbols = s;
 	return s;
 }
 
-Symbol *addFnArg(Symbol *fn, const char *argName)
+Symbol *addFnArgs(Compiler *c, Symbol *fn, int nArgs)
 {
-	ILOG("\tadds symbol %s as argument\n", argName);
-	Symbol *s = createSymbol(argName, KIND_ARG);
-	s->next = NULL;
-	if (fn->args)
-	{
-		Symbol *p;
-		for (p = fn->args; p->next; p = p->next)
-		{
-		}
-		p->next = s;
-	}
-	else
-	{
-		fn->args = s;
-	}
-	return s;
+	fn->args = (Symbol *)arenaAlloc(&c->symArena, nArgs * sizeof(Symbol));
+	fn->nArgs = nArgs;
+	for (int i = 0; i < nArgs; i++)
+		fn->args[i] = (Symbol){.kind = KIND_ARG};
+	return fn->args;
 }
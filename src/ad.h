@@ -1,15 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
-
-typedef struct
-{
-	int type;  // TYPE_*
-	bool lval; // if it is a left-value (required for types analysis)
-} Ret;
-
-extern Ret ret; // used to store data returned from some syntactic rules
-// `extern` keyword is used to say to compiler to allocate memory because this variable will be defined in another source file, here it will only be declarated.
+#include <stddef.h>
 
 enum
 {
@@ -22,34 +14,85 @@ struct Symbol;
 typedef struct Symbol Symbol;
 struct Symbol
 {
-	const char *name; // reference to a name stored in a token
+	int name;			// the interned name (see intern.h)
 	int kind;			// KIND_*
 	int type;			// TYPE_* from tokens
 	union
 	{
-		Symbol *args; // for functions: the list with the function args
-		bool local;	  // for vars: if it is local
+		struct
+		{
+			Symbol *args; // for functions: the array with the function args
+			int nArgs;	  // and their number
+		};
+		bool local; // for vars: if it is local
 	};
+	int order;	  // the order in which the symbols were added, so a function compiled apart sees only the globals defined before it
+	int depth;	  // the depth of its domain
+	Symbol *shadowed; // the symbol with the same name from an outer domain, hidden by this one
 	Symbol *next; // link to the next Symbol in list
 };
 
+// The memory of the symbols and domains: a stack of chunks, from which the memory is taken in order.
+// Every domain remembers the top of the stack before it, so delDomain gives back at once the memory
+// of the domain, of its symbols and of their args, without freeing every object.
+// The global domain is at the bottom, so the globals and the function signatures, added before
+// the domain of their function, live until the end.
+typedef struct
+{
+	struct Chunk *chunk; // the current chunk
+	size_t used;		 // the bytes used from the current chunk
+	struct Chunk *spare; // a freed chunk, kept for reuse
+} Arena;
+
+// the top of an arena at some moment
+typedef struct
+{
+	struct Chunk *chunk;
+	size_t used;
+} ArenaMark;
+
+ArenaMark arenaMark(Arena *a);
+void *arenaAlloc(Arena *a, size_t size);	   // returns size bytes from the top of the arena, aligned for any type
+void arenaRewind(Arena *a, ArenaMark mark); // deletes all the memory taken after the mark
+void arenaFree(Arena *a);					   // frees all the memory of the arena
+
 struct Domain;
 typedef struct Domain Domain;
 struct Domain
 {
+	ArenaMark mark;	 // the top of the arena before this domain
 	Domain *parent;  // the parent of this domain or NULL for the global domain
-	Symbol *symbols; // simple linked list of symbols
+	Symbol *symbols; // simple linked list of symbols, the newest first
+	int depth;		 // 0 for the global domain
 };
 
-extern Domain *symTable; // the symbols table (implemented as a stack of domains)
+// The innermost symbol of every name, so a name is found in O(1) whatever the number of domains and symbols.
+// It is an open addressing hash table keyed by the interned names. Every symbol links to the symbol
+// it shadows, so the symbols of a name make a stack, from which delDomain pops the symbols of its domain.
+typedef struct
+{
+	struct Binding *slots; // the names and their innermost symbols
+	unsigned cap;		   // power of 2
+	int n;				   // the number of used slots
+} Bindings;
+
+// frees the memory of a table of bindings
+void freeBindings(Bindings *b);
+
+// the symbols table and the current function are kept in the Compiler (see compiler.h)
+typedef struct Compiler Compiler;
+
+Domain *addDomain(Compiler *c);											// adds a new domain to ST as the current domain
+void delDomain(Compiler *c);												// deletes the current domain from ST and returns the the last one
+Symbol *searchInCurrentDomain(Compiler *c, int name);	// searches a symbol by name only in the current domain
+Symbol *searchSymbol(Compiler *c, int name);				// searches in all domains
+Symbol *addSymbol(Compiler *c, int name, int kind);		// adds a symbol to the current domain
+Symbol *addFnArgs(Compiler *c, Symbol *fn, int nArgs); // allocates the args of the symbol fn, to be filled by the caller, and returns them
 
-// pointer the symbol of current function, if a function is parsed
-// or NULL outside functions
-extern Symbol *crtFn;
+// The prelude: the predefined functions (puti, putr, puts, ...), declared in src/prelude.q.
+// At build time, tools/prelgen.c compiles them into a read-only table of symbols, which is shared
+// by all the compilations and found by searchSymbol after all the domains, without allocations.
+// Their names are the first interned strings of every compilation, so their ids are fixed in the table.
+// Their lengths and hashes are generated too, so a new compiler adds them without hashing them.
 
-Domain *addDomain();											// adds a new domain to ST as the current domain
-void delDomain();												// deletes the current domain from ST and returns the the last one
-Symbol *searchInCurrentDomain(const char *name);	// searches a symbol by name only in the current domain
-Symbol *searchSymbol(const char *name);				// searches in all domains
-Symbol *addSymbol(const char *name, int kind);		// adds a symbol to the current domain
-Symbol *addFnArg(Symbol *fn, const char *argName); // adds an argument to the symbol fn
+void internPrelude(Compiler *c); // interns the names of the prelude; the table of strings must be empty
@@ -0,0 +1,56 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ast.h"
+#include "compiler.h"
+#include "utils.h"
+
+int addNode(Ast *ast, int kind, int line)
+{
+	if (ast->n == ast->cap)
+	{
+		ast->cap = ast->cap ? ast->cap * 2 : 256;
+		Node *p = (Node *)realloc(ast->nodes, ast->cap * sizeof(Node));
+		if (!p)
+			err("not enough memory");
+		ast->nodes = p;
+	}
+	Node *node = &ast->nodes[ast->n];
+	node->kind = kind;
+	node->op = 0;
+	node->declType = 0;
+	node->type = 0;
+	node->line = line;
+	node->a = node->b = node->c = NO_NODE;
+	node->next = NO_NODE;
+	node->val.r = 0;
+	return ast->n++;
+}
+
+void appendNode(Ast *ast, int *first, int *last, int node)
+{
+	if (*first == NO_NODE)
+		*first = node;
+	else
+		NODE(ast, *last)->next = node;
+	*last = node;
+}
+
+void astReset(Ast *ast)
+{
+	ast->n = 0;
+}
+
+void astFree(Ast *ast)
+{
+	free(ast->nodes);
+	*ast = (Ast){0};
+}
+
+_Noreturn void nodeErr(Compiler *c, int node, const char *fmt, ...)
+{
+	va_list va;
+	va_start(va, fmt);
+	compileVErr(c, NODE(&c->ast, node)->line, fmt, va);
+}
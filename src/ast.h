@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdbool.h>
+
+// The abstract syntax tree (AST) built by the parser.
+// All the nodes are stored in a single array (the arena) and they refer to each other
+// by their indexes in this array, not by pointers, so the array can grow without
+// invalidating the tree and the whole tree is freed at once by astReset.
+// The lists (instructions, params, args) are linked by the "next" field of their nodes.
+//
+// The tree is processed by separate passes: the types analysis (checkItem in at.h),
+// which also fills the symbols table, and the code generation (genItem in gen.h).
+
+#define NO_NODE (-1) // a missing child or the end of a list
+
+enum
+{
+	N_VAR,	  // VAR ID COLON baseType: id, declType
+	N_FUNC,	  // FUNCTION: id, declType (the return type), a = params, b = local vars, c = body
+	N_PARAM,  // id, declType
+	N_IF,	  // a = condition, b = then block, c = else block
+	N_WHILE,  // a = condition, b = body
+	N_RETURN, // a = the returned expression
+	N_EXPR,	  // an expression used as instruction: a = expression
+	N_INT,	  // val.i
+	N_REAL,	  // val.r
+	N_STR,	  // val.id
+	N_ID,	  // a variable or argument used in an expression: val.id
+	N_CALL,	  // val.id = the function name, a = args
+	N_ASSIGN, // a = destination (N_ID), b = source
+	N_BINARY, // op, a = left operand, b = right operand
+	N_UNARY	  // op, a = operand
+};
+
+typedef struct
+{
+	unsigned char kind;		// N_*
+	unsigned char op;		// for N_BINARY and N_UNARY: the operator token code (ADD, LESS, ...)
+	unsigned char declType; // for definitions: the declared TYPE_*
+	unsigned char type;		// for expressions: the TYPE_* set by the types analysis
+	int line;				// the line in the source, for error messages
+	int a, b, c;			// the children, NO_NODE if missing
+	int next;				// the next node in a list, NO_NODE at the end
+	union
+	{
+		int i;	  // for N_INT
+		double r; // for N_REAL
+		int id;	  // for N_STR and for the names: the interned string (see intern.h)
+	} val;
+} Node;
+
+typedef struct
+{
+	Node *nodes;
+	int n, cap;
+} Ast;
+
+// the node at index i from the tree ast; the pointer is valid only until the next addNode
+#define NODE(ast, i) (&(ast)->nodes[(i)])
+
+// adds a new node, with all children missing, and returns its index
+int addNode(Ast *ast, int kind, int line);
+
+// appends the node to the list given by its first and last nodes
+void appendNode(Ast *ast, int *first, int *last, int node);
+
+// deletes all the nodes at once, keeping the memory for the next tree
+void astReset(Ast *ast);
+
+// frees the memory of the tree
+void astFree(Ast *ast);
+
+typedef struct Compiler Compiler;
+
+// same as compileErr, with the line of a node from the compiler tree
+_Noreturn void nodeErr(Compiler *c, int node, const char *fmt, ...);
@@ -1,29 +1,225 @@
 #include <stddef.h>
+#include <stdio.h>
 
 #include "lexer.h"
 #include "ad.h"
+#include "ast.h"
+#include "compiler.h"
+#include "intern.h"
+#include "utils.h"
 
-// adds in ST a function with an argument
-// the argument has the type argType and the function returns the type retType
-Symbol *addFn1Arg(const char *fnName, int argType, int retType)
+// adds to the current domain a symbol defined by a node, if it is not already defined
+Symbol *defineSymbol(Compiler *c, int node, int kind)
 {
-    Symbol *fn = addSymbol(fnName, KIND_FN);
-    fn->type = retType;
-    fn->args = NULL;
-    Symbol *arg = addFnArg(fn, "arg");
-    arg->type = argType;
+    Node *n = NODE(&c->ast, node);
+    if (searchInCurrentDomain(c, n->val.id))
+    {
+        ELOG("symbol redefinition: %s\n", internText(c->strings, n->val.id));
+        nodeErr(c, node, "symbol redefinition: %s", internText(c->strings, n->val.id));
+    }
+    Symbol *s = addSymbol(c, n->val.id, kind);
+    s->type = n->declType;
+    return s;
+}
+
+// searches a symbol used in an expression
+Symbol *useSymbol(Compiler *c, int node)
+{
+    Symbol *s = searchSymbol(c, NODE(&c->ast, node)->val.id);
+    if (!s)
+        nodeErr(c, node, "undefined symbol: %s", internText(c->strings, NODE(&c->ast, node)->val.id));
+    return s;
+}
+
+// sets the type of an expression and of all its subexpressions
+void checkExpr(Compiler *c, int node)
+{
+    Node *n = NODE(&c->ast, node);
+    switch (n->kind)
+    {
+    case N_INT:
+        n->type = TYPE_INT;
+        break;
+    case N_REAL:
+        n->type = TYPE_REAL;
+        break;
+    case N_STR:
+        n->type = TYPE_STR;
+        break;
+
+    case N_ID:
+    {
+        Symbol *s = useSymbol(c, node);
+        if (s->kind == KIND_FN)
+            nodeErr(c, node, "the function %s can only be called", internText(c->strings, s->name));
+        n->type = s->type;
+        break;
+    }
+
+    case N_CALL:
+    {
+        Symbol *s = useSymbol(c, node);
+        if (s->kind != KIND_FN)
+            nodeErr(c, node, "%s cannot be called, because it is not a function", internText(c->strings, s->name));
+        // the arity is checked before the args, so a wrong call does not check its args in vain
+        int nArgs = 0;
+        for (int arg = n->a; arg != NO_NODE; arg = NODE(&c->ast, arg)->next, nArgs++)
+        {
+            if (nArgs == s->nArgs)
+                nodeErr(c, arg, "the function %s is called with too many arguments", internText(c->strings, s->name));
+        }
+        if (nArgs < s->nArgs)
+            nodeErr(c, node, "the function %s is called with too few arguments", internText(c->strings, s->name));
+        int i = 0;
+        for (int arg = n->a; arg != NO_NODE; arg = NODE(&c->ast, arg)->next, i++)
+        {
+            checkExpr(c, arg);
+            if (s->args[i].type != NODE(&c->ast, arg)->type)
+                nodeErr(c, arg, "the argument type at function %s call is different from the one given at its definition", internText(c->strings, s->name));
+        }
+        n->type = s->type;
+        break;
+    }
+
+    case N_ASSIGN:
+    {
+        Symbol *dst = useSymbol(c, n->a);
+        if (dst->kind == KIND_FN)
+            nodeErr(c, n->a, "a function (%s) cannot be used as a destination for assignment ", internText(c->strings, dst->name));
+        NODE(&c->ast, n->a)->type = dst->type;
+        checkExpr(c, n->b);
+        if (dst->type != NODE(&c->ast, n->b)->type)
+            nodeErr(c, node, "the source and destination for assignment must have the same type");
+        n->type = dst->type;
+        break;
+    }
+
+    case N_BINARY:
+    {
+        const char *sign = ATOMS_SPELLING[n->op];
+        checkExpr(c, n->a);
+        int left = NODE(&c->ast, n->a)->type;
+        switch (n->op)
+        {
+        case AND:
+        case OR:
+            if (left == TYPE_STR)
+                nodeErr(c, node, "the left operand of %s cannot be of type str", sign);
+            checkExpr(c, n->b);
+            if (NODE(&c->ast, n->b)->type == TYPE_STR)
+                nodeErr(c, node, "the right operand of %s cannot be of type str", sign);
+            n->type = TYPE_INT;
+            break;
+        case LESS:
+        case EQUAL:
+            checkExpr(c, n->b);
+            if (left != NODE(&c->ast, n->b)->type)
+                nodeErr(c, node, "different types for the operands of %s", sign);
+            n->type = TYPE_INT; // the result of comparation is int 0 or 1
+            break;
+        default: // ADD, SUB, MUL, DIV
+            if (left == TYPE_STR)
+                nodeErr(c, node, "the operands of %s cannot be of type str", sign);
+            checkExpr(c, n->b);
+            if (left != NODE(&c->ast, n->b)->type)
+                nodeErr(c, node, "different types for the operands of %s", sign);
+            n->type = left;
+        }
+        break;
+    }
+
+    case N_UNARY:
+        checkExpr(c, n->a);
+        if (NODE(&c->ast, n->a)->type == TYPE_STR)
+            nodeErr(c, node, "the expression of %s must be of type int or real", n->op == SUB ? "unary -" : "!");
+        n->type = n->op == SUB ? NODE(&c->ast, n->a)->type : TYPE_INT;
+        break;
+    }
+}
+
+void checkInstrs(Compiler *c, int first);
+
+void checkInstr(Compiler *c, int node)
+{
+    Node *n = NODE(&c->ast, node);
+    switch (n->kind)
+    {
+    case N_IF:
+    case N_WHILE:
+        checkExpr(c, n->a);
+        if (NODE(&c->ast, n->a)->type == TYPE_STR)
+            nodeErr(c, n->a, "the %s condition must have type int or real", n->kind == N_IF ? "if" : "while");
+        checkInstrs(c, n->b);
+        checkInstrs(c, n->c);
+        break;
+    case N_RETURN:
+        checkExpr(c, n->a);
+        if (!c->crtFn)
+            nodeErr(c, node, "return can be used only in a function");
+        if (NODE(&c->ast, n->a)->type != c->crtFn->type)
+            nodeErr(c, node, "the return type must be the same as the function return type");
+        break;
+    case N_EXPR:
+        checkExpr(c, n->a);
+        break;
+    }
+}
+
+void checkInstrs(Compiler *c, int first)
+{
+    for (int node = first; node != NO_NODE; node = NODE(&c->ast, node)->next)
+        checkInstr(c, node);
+}
+
+void checkVar(Compiler *c, int node)
+{
+    Symbol *s = defineSymbol(c, node, KIND_VAR);
+    s->local = c->crtFn != NULL;
+}
+
+Symbol *declareFunc(Compiler *c, int node)
+{
+    Node *n = NODE(&c->ast, node);
+    Symbol *fn = defineSymbol(c, node, KIND_FN);
+    int nArgs = 0;
+    for (int param = n->a; param != NO_NODE; param = NODE(&c->ast, param)->next)
+        nArgs++;
+    Symbol *args = addFnArgs(c, fn, nArgs);
+    int i = 0;
+    for (int param = n->a; param != NO_NODE; param = NODE(&c->ast, param)->next, i++)
+    {
+        args[i].name = NODE(&c->ast, param)->val.id;
+        args[i].type = NODE(&c->ast, param)->declType;
+    }
     return fn;
 }
 
-void addPredefinedFns()
+void checkFunc(Compiler *c, int node)
 {
-    addFn1Arg("puti", TYPE_INT, TYPE_INT);
-    addFn1Arg("putr", TYPE_REAL, TYPE_REAL);
-    addFn1Arg("puts", TYPE_STR, TYPE_STR);
+    Node *n = NODE(&c->ast, node);
+    // a function job finds the function already declared by its parent
+    c->crtFn = c->inFnJob ? searchSymbol(c, n->val.id) : declareFunc(c, node);
+    addDomain(c);
+    for (int param = n->a; param != NO_NODE; param = NODE(&c->ast, param)->next)
+        defineSymbol(c, param, KIND_ARG);
+    for (int var = n->b; var != NO_NODE; var = NODE(&c->ast, var)->next)
+        checkVar(c, var);
+    checkInstrs(c, n->c);
+    delDomain(c);
+    c->crtFn = NULL;
 }
 
-void setRet(int type, bool lval)
+void checkItem(Compiler *c, int node)
 {
-    ret.type = type;
-    ret.lval = lval;
+    switch (NODE(&c->ast, node)->kind)
+    {
+    case N_VAR:
+        checkVar(c, node);
+        break;
+    case N_FUNC:
+        checkFunc(c, node);
+        break;
+    default:
+        checkInstr(c, node);
+    }
 }
@@ -1,10 +1,13 @@
 #pragma once
 
-#include <stdbool.h>
+typedef struct Compiler Compiler;
+typedef struct Symbol Symbol;
 
-// adds in ST the predefined functions from example: puti, putr, puts.
-// if they are not added, an error message would be thrown, because these would be undefined
-void addPredefinedFns();
+// the types analysis of a top level item from the AST (a variable, a function or an instruction)
+// it adds the defined symbols to ST and sets the types of all the expressions from the item
+// on error, prints a message with the line of the wrong node and exit the program
+void checkItem(Compiler *c, int node);
 
-// sets the global variable "ret" with the resulted type from a rule
-void setRet(int type, bool lval);
\ No newline at end of file
+// defines in the current domain the symbol of a function from the AST, with its args, and returns it
+// the body is checked later, by checkItem on a function job (see Compiler.parallelFns)
+Symbol *declareFunc(Compiler *c, int node);
@@ -0,0 +1,195 @@
+#include <dirent.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "compiler.h"
+#include "utils.h"
+
+// when the entries exceed maxSize, the oldest ones are deleted until they have this percent of it
+#define EVICT_TO_PERCENT 75
+// a temporary file older than this (in seconds) was left by a process which stopped while writing it
+#define STALE_TMP_SECONDS (10 * 60)
+
+// ********************* entries *******************
+
+// the path of a file from the cache directory
+static char *pathOf(Cache *cache, const char *name)
+{
+	size_t len = strlen(cache->dir) + strlen(name) + 2;
+	char *path = (char *)safeAlloc(len);
+	snprintf(path, len, "%s/%s", cache->dir, name);
+	return path;
+}
+
+// an entry has the name <key>.c
+static bool isEntry(const char *name)
+{
+	size_t len = strlen(name);
+	return len == CACHE_KEY_LEN + 2 && !strcmp(name + CACHE_KEY_LEN, ".c");
+}
+
+// an entry is written in a temporary file named tmp-XXXXXX (see cachePut)
+static bool isTemp(const char *name)
+{
+	return !strncmp(name, "tmp-", 4);
+}
+
+typedef struct
+{
+	char *name;
+	unsigned long long size;
+	struct timespec used;
+} Entry;
+
+static int olderFirst(const void *a, const void *b)
+{
+	const struct timespec *ta = &((const Entry *)a)->used, *tb = &((const Entry *)b)->used;
+	if (ta->tv_sec != tb->tv_sec)
+		return ta->tv_sec < tb->tv_sec ? -1 : 1;
+	return ta->tv_nsec < tb->tv_nsec ? -1 : ta->tv_nsec > tb->tv_nsec;
+}
+
+// finds the size of all the entries and, if evict is true and they exceed the limit,
+// deletes the least recently used ones
+// the stale temporary files are deleted and the others are counted in the size, but never evicted
+static void scanEntries(Cache *cache, bool evict)
+{
+	DIR *dir = opendir(cache->dir);
+	if (!dir)
+		return;
+	Entry *entries = NULL;
+	int n = 0, cap = 0;
+	unsigned long long total = 0;
+	time_t now = time(NULL);
+	for (struct dirent *d; (d = readdir(dir));)
+	{
+		struct stat st;
+		bool temp = isTemp(d->d_name);
+		if ((!temp && !isEntry(d->d_name)) || fstatat(dirfd(dir), d->d_name, &st, 0) < 0)
+			continue;
+		if (temp)
+		{
+			if (now - st.st_mtim.tv_sec > STALE_TMP_SECONDS)
+				unlinkat(dirfd(dir), d->d_name, 0);
+			else
+				total += st.st_size;
+			continue;
+		}
+		if (n == cap)
+		{
+			cap = cap ? cap * 2 : 256;
+			Entry *p = (Entry *)realloc(entries, cap * sizeof(Entry));
+			if (!p)
+				err("not enough memory");
+			entries = p;
+		}
+		entries[n++] = (Entry){strdup(d->d_name), (unsigned long long)st.st_size, st.st_mtim};
+		total += st.st_size;
+	}
+	if (evict && total > cache->maxSize)
+	{
+		qsort(entries, n, sizeof(Entry), olderFirst);
+		// another process can delete the same entries, so a failed unlink is not an error
+		for (int i = 0; i < n && total > cache->maxSize / 100 * EVICT_TO_PERCENT; i++)
+		{
+			unlinkat(dirfd(dir), entries[i].name, 0);
+			total -= entries[i].size;
+		}
+	}
+	for (int i = 0; i < n; i++)
+		free(entries[i].name);
+	free(entries);
+	closedir(dir);
+	cache->size = total;
+}
+
+bool cacheOpen(Cache *cache, const char *dir, unsigned long long maxSize, const uint64_t exeHash[2])
+{
+	if (mkdir(dir, 0777) < 0 && errno != EEXIST)
+		return false;
+	cache->dir = strdup(dir);
+	cache->maxSize = maxSize;
+	// any change of the transpiler changes its executable, so its hash is part of every key
+	cache->exeHash[0] = exeHash[0];
+	cache->exeHash[1] = exeHash[1];
+	scanEntries(cache, false);
+	return true;
+}
+
+void cacheClose(Cache *cache)
+{
+	free(cache->dir);
+	cache->dir = NULL;
+}
+
+void cacheKey(Cache *cache, const char *src, size_t size, unsigned flags, char *key)
+{
+	uint64_t h[2] = {cache->exeHash[0], cache->exeHash[1]};
+	hashBytes(h, &flags, sizeof(flags));
+	hashBytes(h, &size, sizeof(size));
+	hashBytes(h, src, size);
+	hashHex(h, key);
+}
+
+bool cacheGet(Cache *cache, const char *key, const char *outName)
+{
+	char name[CACHE_KEY_LEN + 3];
+	snprintf(name, sizeof(name), "%s.c", key);
+	char *path = pathOf(cache, name);
+	FILE *entry = fopen(path, "rb");
+	free(path);
+	if (!entry)
+		return false;
+	bool ok = false;
+	struct stat st;
+	if (fstat(fileno(entry), &st) == 0)
+	{
+		size_t n = (size_t)st.st_size;
+		char *buf = (char *)safeAlloc(n + 1);
+		FILE *fis = NULL;
+		if (fread(buf, 1, n, entry) == n && (fis = fopen(outName, "w")))
+		{
+			ok = fwrite(buf, 1, n, fis) == n;
+			ok = !fclose(fis) && ok;
+		}
+		free(buf);
+		futimens(fileno(entry), NULL); // the time of the last use, for eviction
+	}
+	fclose(entry);
+	return ok;
+}
+
+void cachePut(Cache *cache, const char *key, Compiler *c)
+{
+	char *tmp = pathOf(cache, "tmp-XXXXXX");
+	int fd = mkstemp(tmp);
+	if (fd < 0)
+	{
+		free(tmp);
+		return;
+	}
+	fchmod(fd, 0644); // mkstemp allows only its owner to read it
+	close(fd);
+	char name[CACHE_KEY_LEN + 3];
+	snprintf(name, sizeof(name), "%s.c", key);
+	char *path = pathOf(cache, name);
+	if (writeCode(c, tmp) && rename(tmp, path) == 0)
+	{
+		unsigned long long size = codeSize(c);
+		if ((cache->size += size) > cache->maxSize)
+			scanEntries(cache, true);
+	}
+	else
+	{
+		unlink(tmp);
+	}
+	free(path);
+	free(tmp);
+}
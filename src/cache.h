@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+// An on-disk cache of the generated C code, shared by all the builds which use the same directory.
+// Every entry is the file <key>.c, where the key is a hash of the source, of the transpiler
+// executable and of the options which can change the output, so an entry never becomes stale.
+// The entries are written in temporary files and then renamed, so a reader never sees a partial entry,
+// even when several processes use the cache at the same time. The temporary files left by
+// a process which stopped while writing them are deleted when the cache is opened or evicted.
+// When the entries exceed the size limit, the least recently used ones are deleted.
+
+#define CACHE_KEY_LEN HASH_HEX_LEN // the hex digits of a key
+
+typedef struct Compiler Compiler;
+
+typedef struct
+{
+	char *dir;
+	unsigned long long maxSize;		  // the size limit of all the entries, in bytes
+	uint64_t exeHash[2];			  // the hash of the transpiler executable
+	_Atomic unsigned long long size; // the approximate size of all the entries
+} Cache;
+
+// opens the cache from the directory dir, creating it if needed
+// exeHash is the hash of the transpiler (see hashExe), part of every key
+// returns false if the directory cannot be created, with the cause in errno
+bool cacheOpen(Cache *cache, const char *dir, unsigned long long maxSize, const uint64_t exeHash[2]);
+
+// frees the memory of the cache; the entries remain on disk
+void cacheClose(Cache *cache);
+
+// computes in key (with CACHE_KEY_LEN+1 chars) the key of a source compiled with the given option flags
+void cacheKey(Cache *cache, const char *src, size_t size, unsigned flags, char *key);
+
+// if the cache has the entry key, copies it in the file outName and returns true
+bool cacheGet(Cache *cache, const char *key, const char *outName);
+
+// adds the code generated by a compiler as the entry key
+// the errors are ignored, because the cache is only an optimization
+void cachePut(Cache *cache, const char *key, Compiler *c);
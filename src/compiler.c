@@ -0,0 +1,341 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "compiler.h"
+#include "sintaxer.h"
+#include "pool.h"
+#include "trace.h"
+#include "at.h"
+#include "utils.h"
+
+void compilerInit(Compiler *c)
+{
+	*c = (Compiler){0};
+	c->nThreads = nCores();
+	c->outBudget = OUT_BUDGET;
+	c->strings = &c->ownStrings;
+	internPrelude(c);
+	c->preludeStrings = internMark(c->strings);
+}
+
+static void freeFnJobs(Compiler *c)
+{
+	for (int i = 0; i < c->nFnJobs; i++)
+		Text_clear(&c->fnJobs[i].code);
+	free(c->fnJobs);
+	c->fnJobs = NULL;
+	c->nFnJobs = c->capFnJobs = 0;
+}
+
+void compilerFree(Compiler *c)
+{
+	while (c->symTable) // after an error, some domains can remain
+		delDomain(c);
+	freeBindings(&c->names);
+	arenaFree(&c->symArena);
+	astFree(&c->ast);
+	freeTokens(&c->tokens);
+	internFree(&c->ownStrings);
+	Text_clear(&c->tBegin);
+	Text_clear(&c->tMain);
+	Text_clear(&c->tFunctions);
+	spillFree(&c->functionsSpill);
+	spillFree(&c->mainSpill);
+	freeFnJobs(c);
+}
+
+// after an error, some domains can remain
+static void resetDomains(Compiler *c)
+{
+	while (c->symTable)
+		delDomain(c);
+	c->nSymbols = 0;
+}
+
+void compilerReset(Compiler *c)
+{
+	resetDomains(c);
+	internRelease(c->strings, c->preludeStrings);
+	astReset(&c->ast);
+	Text_reset(&c->tBegin);
+	Text_reset(&c->tMain);
+	Text_reset(&c->tFunctions);
+	spillFree(&c->functionsSpill);
+	spillFree(&c->mainSpill);
+	freeFnJobs(c);
+	c->crtFn = NULL;
+	c->errMsg[0] = '\0';
+	c->errLine = 0;
+}
+
+void addFnJob(Compiler *c, int firstTk, int endTk, int order)
+{
+	if (c->nFnJobs == c->capFnJobs)
+	{
+		c->capFnJobs = c->capFnJobs ? c->capFnJobs * 2 : 16;
+		FnJob *p = (FnJob *)realloc(c->fnJobs, c->capFnJobs * sizeof(FnJob));
+		if (!p)
+			err("not enough memory");
+		c->fnJobs = p;
+	}
+	c->fnJobs[c->nFnJobs++] = (FnJob){.firstTk = firstTk, .endTk = endTk, .order = order};
+}
+
+// parses, checks and generates a function body on the compiler of a function job
+static bool compileFnBody(Compiler *fc)
+{
+	jmp_buf onErr;
+	fc->onErr = &onErr;
+	if (setjmp(onErr))
+		return false;
+	int node = defFunc(fc);
+	checkItem(fc, node);
+	genItem(fc, node);
+	return true;
+}
+
+// the state of compileFns, shared by its jobs
+typedef struct
+{
+	Compiler *c;
+	pthread_mutex_t lock; // for the fields below, for FnJob.done and for functionsSpill
+	int nSpilled;		  // the jobs [0,nSpilled) have their code in functionsSpill
+	size_t kept;		  // the chars of the ended jobs whose code is in memory
+	int spillErr;		  // the errno of a failed spill or 0
+} FnJobs;
+
+// called when a job ends: while the code in memory is over outBudget, it moves to functionsSpill
+// the code of the ended jobs which are next in the source order
+static void spillFnJobs(FnJobs *jobs, FnJob *ended)
+{
+	Compiler *c = jobs->c;
+	if (!c->outBudget)
+		return;
+	pthread_mutex_lock(&jobs->lock);
+	ended->done = true;
+	jobs->kept += ended->code.n;
+	while (jobs->nSpilled < c->nFnJobs && !jobs->spillErr && jobs->kept + c->tFunctions.n + c->tMain.n > c->outBudget)
+	{
+		FnJob *job = &c->fnJobs[jobs->nSpilled];
+		if (!job->done || !job->ok) // a failed job stops the compilation, so its code is not needed
+			break;
+		size_t n = job->code.n;
+		job->spillPos = c->functionsSpill.n;
+		if (!spillText(&c->functionsSpill, &job->code))
+		{
+			jobs->spillErr = errno;
+			break;
+		}
+		Text_clear(&job->code);
+		job->spilled = true;
+		job->spillLen = n;
+		jobs->kept -= n;
+		jobs->nSpilled++;
+	}
+	pthread_mutex_unlock(&jobs->lock);
+}
+
+static void runFnJob(Compiler *c, FnJob *job)
+{
+	if (c->prevFns)
+	{
+		fnFingerprint(c, job);
+		const FnCode *prev = fnStateFind(c->prevFns, job->fp);
+		if (prev) // unchanged since the previous compilation
+		{
+			Text_append(&job->code, prev->code, prev->len);
+			job->ok = true;
+			return;
+		}
+	}
+	// the job only reads the tokens, the interned strings and the global domain of its parent,
+	// everything else is its own
+	Compiler fc = {0};
+	fc.strings = c->strings;
+	fc.tokens = c->tokens;
+	fc.symTable = c->symTable;
+	fc.outerNames = &c->names;
+	fc.inFnJob = true;
+	fc.fnOrder = job->order;
+	fc.iTk = job->firstTk;
+	job->ok = compileFnBody(&fc);
+	if (!job->ok)
+	{
+		job->errLine = fc.errLine;
+		memcpy(job->errMsg, fc.errMsg, MAX_ERR);
+	}
+	while (fc.symTable != c->symTable) // after an error, the domains of the function can remain
+		delDomain(&fc);
+	freeBindings(&fc.names);
+	arenaFree(&fc.symArena);
+	astFree(&fc.ast);
+	job->code = fc.tFunctions;
+}
+
+static void compileFnJob(int i, void *arg)
+{
+	FnJobs *jobs = (FnJobs *)arg;
+	FnJob *job = &jobs->c->fnJobs[i];
+	runFnJob(jobs->c, job);
+	spillFnJobs(jobs, job);
+}
+
+void compileFns(Compiler *c)
+{
+	// after it, the jobs can get the texts of the strings without changing the table
+	internTexts(c->strings);
+	// the spilled jobs follow the chars of tFunctions, so they must be spilled before
+	if (c->outBudget && !spillText(&c->functionsSpill, &c->tFunctions))
+		compileErr(c, tkLine(&c->tokens, c->iTk), "cannot write the generated code in a temp file: %s", strerror(errno));
+	FnJobs jobs = {.c = c};
+	pthread_mutex_init(&jobs.lock, NULL);
+	runParallel(c->nFnJobs, compileFnJob, &jobs, c->nThreads);
+	pthread_mutex_destroy(&jobs.lock);
+	for (int i = 0; i < c->nFnJobs; i++)
+	{
+		FnJob *job = &c->fnJobs[i];
+		if (!job->ok)
+			compileErr(c, job->errLine, "%s", job->errMsg);
+	}
+	if (jobs.spillErr)
+		compileErr(c, tkLine(&c->tokens, c->iTk), "cannot write the generated code in a temp file: %s", strerror(jobs.spillErr));
+}
+
+// deletes everything done by the parser, but keeps the tokens, so they can be parsed again
+static void resetParse(Compiler *c)
+{
+	resetDomains(c);
+	astReset(&c->ast);
+	Text_clear(&c->tBegin);
+	Text_clear(&c->tMain);
+	Text_clear(&c->tFunctions);
+	spillFree(&c->functionsSpill);
+	spillFree(&c->mainSpill);
+	freeFnJobs(c);
+	c->crtFn = NULL;
+}
+
+// lexes (if lex is true) and parses the source, returning false on error
+static bool runPhases(Compiler *c, size_t size, bool lex)
+{
+	jmp_buf onErr;
+	c->onErr = &onErr;
+	c->lexer.onErr = &onErr;
+	if (setjmp(onErr))
+	{
+		if (c->lexer.errLine) // the error was found by the lexer
+		{
+			c->errLine = c->lexer.errLine;
+			memcpy(c->errMsg, c->lexer.errMsg, MAX_ERR);
+		}
+		c->onErr = NULL;
+		c->lexer.onErr = NULL;
+		return false;
+	}
+
+	if (lex && c->stream)
+	{
+		tokenizeLazy(&c->lexer, size);
+	}
+	else if (lex)
+	{
+		tokenizeParallel(&c->lexer, size, c->nThreads);
+		if (traceLevel >= TRACE_TOKENS)
+			showTokens(&c->tokens);
+	}
+	parse(c);
+
+	c->onErr = NULL;
+	c->lexer.onErr = NULL;
+	return true;
+}
+
+bool compile(Compiler *c, const char *src, size_t size)
+{
+	lexerInit(&c->lexer, &c->tokens, c->strings, src);
+	c->splitFns = (c->parallelFns || c->prevFns) && !c->stream;
+	if (runPhases(c, size, true))
+		return true;
+	if (!c->splitFns || c->lexer.errLine)
+		return false;
+	// the serial compilation could stop earlier, in a function body before the error found now
+	// (ex: a syntax error in a later function and a types error in an earlier one),
+	// so the tokens are parsed again serially, to report the same error
+	resetParse(c);
+	c->splitFns = false;
+	return runPhases(c, size, false);
+}
+
+_Noreturn void compileVErr(Compiler *c, int line, const char *fmt, va_list va)
+{
+	vsnprintf(c->errMsg, MAX_ERR, fmt, va);
+	// some messages end with a newline
+	size_t len = strlen(c->errMsg);
+	while (len && c->errMsg[len - 1] == '\n')
+		c->errMsg[--len] = '\0';
+	c->errLine = line;
+	if (c->onErr)
+		longjmp(*c->onErr, 1);
+	showCompileErr(c);
+	exit(EXIT_FAILURE);
+}
+
+_Noreturn void compileErr(Compiler *c, int line, const char *fmt, ...)
+{
+	va_list va;
+	va_start(va, fmt);
+	compileVErr(c, line, fmt, va);
+}
+
+void showCompileErr(Compiler *c)
+{
+	fprintf(stderr, "error in line %d: %s\n", c->errLine, c->errMsg);
+}
+
+void spillCode(Compiler *c)
+{
+	if (!c->outBudget || c->tFunctions.n + c->tMain.n <= c->outBudget)
+		return;
+	if (!spillText(&c->functionsSpill, &c->tFunctions) || !spillText(&c->mainSpill, &c->tMain))
+		compileErr(c, tkLine(&c->tokens, c->iTk), "cannot write the generated code in a temp file: %s", strerror(errno));
+}
+
+size_t codeSize(Compiler *c)
+{
+	size_t size = c->tBegin.n + c->functionsSpill.n + c->tFunctions.n + c->mainSpill.n + c->tMain.n;
+	for (int i = 0; i < c->nFnJobs; i++)
+		size += c->fnJobs[i].code.n;
+	return size;
+}
+
+// the global variables must be before the functions and main must be the last,
+// so the sections are written only at the end, each one after its spilled chars
+// the spilled jobs are the first ones and their code is empty, so only the others are written from memory
+bool writeCodeTo(Compiler *c, int fd)
+{
+	Sink sink;
+	sinkInit(&sink, fd);
+	sinkChars(&sink, c->tBegin.buf, c->tBegin.n);
+	sinkSpill(&sink, &c->functionsSpill);
+	sinkChars(&sink, c->tFunctions.buf, c->tFunctions.n);
+	for (int i = 0; i < c->nFnJobs; i++)
+		sinkChars(&sink, c->fnJobs[i].code.buf, c->fnJobs[i].code.n);
+	sinkSpill(&sink, &c->mainSpill);
+	sinkChars(&sink, c->tMain.buf, c->tMain.n);
+	return sinkFlush(&sink);
+}
+
+bool writeCode(Compiler *c, const char *fileName)
+{
+	int fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+		return false;
+	bool ok = writeCodeTo(c, fd);
+	return !close(fd) && ok;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdarg.h>
+
+#include "lexer.h"
+#include "intern.h"
+#include "ast.h"
+#include "ad.h"
+#include "gen.h"
+#include "fnstate.h"
+#include "sink.h"
+
+// a function whose body is compiled apart from the rest of the program (see parallelFns)
+typedef struct FnJob
+{
+	int firstTk;	// the index of its FUNCTION token
+	int endTk;		// the index of the token after its END
+	int order;		// the definition order of its symbol (see Symbol.order)
+	uint64_t fp[2]; // its fingerprint, if prevFns is used (see fnstate.h)
+	Text code;	 // its generated C code
+	bool ok;	 // if false, the error is in errMsg and errLine
+	bool done;	 // if it ended (see outBudget)
+	bool spilled; // if its code was moved to functionsSpill, at spillPos, with spillLen chars
+	size_t spillPos, spillLen;
+	char errMsg[MAX_ERR];
+	int errLine;
+} FnJob;
+
+// All the state of a compilation. Every phase takes it as a parameter, so several
+// compilations can run at the same time on different threads, or one after another
+// in the same process.
+typedef struct Compiler
+{
+	// options, set before compile
+	bool stream;  // if true, the tokens are lexed only when the parser needs them (see tokenizeLazy)
+	int nThreads; // the number of threads for the parallel lexing and for parallelFns
+	// if true, the function bodies are compiled in parallel, after the rest of the program, and
+	// their code is put in the source order, so the output is the same as the serial one
+	// it is ignored with stream, because the functions are found in the whole tokens list
+	bool parallelFns;
+	// if not NULL, the code of the functions from the previous compilation, reused for the functions
+	// with the same fingerprint; the function bodies are split like with parallelFns
+	FnState *prevFns;
+	// the max chars of tFunctions, tMain and of the function jobs code kept in memory; over it,
+	// they are spilled to temp files; 0 keeps all the generated code in memory
+	size_t outBudget;
+
+	// lexical analysis
+	Interner *strings;	 // the interned chars of ID and STR, shared with the function jobs
+	Interner ownStrings; // the table used by strings, if this compiler is not a function job
+	Tokens tokens;
+	Lexer lexer;
+
+	// syntactic analysis
+	int iTk;	  // the iterator in tokens
+	int consumed; // the index of the last consumed token
+	Ast ast;	  // the tree of the current top level item
+
+	// domain and types analysis
+	Domain *symTable; // the symbols table (implemented as a stack of domains)
+	Symbol *crtFn;	  // the symbol of the current function or NULL outside functions
+	Bindings names;	  // the innermost symbol of every name, from all the domains
+	Bindings *outerNames; // in a function job: the names of its parent, only read
+	int nSymbols;	  // the number of symbols added until now, to set Symbol.order
+	InternMark preludeStrings; // the interned names of the prelude, kept between compilations
+	Arena symArena;	  // the memory of the domains and symbols
+
+	// the function bodies compiled in parallel (see parallelFns)
+	bool splitFns;			// while parsing, the function bodies are only skipped and added to fnJobs
+	FnJob *fnJobs;			// the skipped functions, in the source order
+	int nFnJobs, capFnJobs;
+	bool inFnJob;			// if true, this compiler only compiles the body of a function skipped by its parent
+	int fnOrder;			// in a function job: the order of the function symbol, the last global visible in it
+
+	// code generation
+	Text tBegin,	// for header file and global variabiles
+		tMain,		// the Quick global code, which will be considered as the body of the C main function
+		tFunctions; // the functions from Quick
+	Text *crtCode;	// if in a function, it points to tFunctions, else to tMain
+	Text *crtVar;	// if in a function, it points to tFunctions, else to tBegin
+	Spill functionsSpill, mainSpill; // the older chars of tFunctions and tMain, moved out of memory (see outBudget)
+
+	// errors
+	jmp_buf *onErr; // where compileErr jumps while compile runs
+	char errMsg[MAX_ERR];
+	int errLine;
+} Compiler;
+
+// initializes an empty compiler, with the default options
+void compilerInit(Compiler *c);
+
+// frees all the memory used by a compiler
+void compilerFree(Compiler *c);
+
+// adds a function job, for a function whose header was parsed and whose body was skipped
+void addFnJob(Compiler *c, int firstTk, int endTk, int order);
+
+// compiles in parallel the bodies of all the skipped functions
+// their code is kept in their jobs and it is written after tFunctions, in the source order
+// over outBudget, the code of the ended jobs is moved to functionsSpill, in the source order
+// it must be called at the end of the program, while the global domain still exists
+void compileFns(Compiler *c);
+
+// prepares a compiler for a new compile, keeping its options, its memory and the names of the prelude
+// it is used when the same compiler transpiles many sources (see server.h)
+// after it, the source of the previous compile is no longer used
+void compilerReset(Compiler *c);
+
+// compiles the Quick source from src, which must be ended with \0
+// size is the length of the source, without the final \0
+// the source must remain valid until the compiler is freed
+// on error returns false, with the message in errMsg and its line in errLine
+bool compile(Compiler *c, const char *src, size_t size);
+
+// reports an error in the given line of the source and stops the compilation
+// if compile does not run, prints the error and exit the program
+_Noreturn void compileErr(Compiler *c, int line, const char *fmt, ...);
+_Noreturn void compileVErr(Compiler *c, int line, const char *fmt, va_list va);
+
+// prints on stderr the error of a failed compilation
+void showCompileErr(Compiler *c);
+
+// the default outBudget, in bytes
+#define OUT_BUDGET ((size_t)64 << 20)
+
+// spills tFunctions and tMain to their temp files if they are over outBudget
+// it is called between the top level items, so the memory of the generated code stays bounded
+void spillCode(Compiler *c);
+
+// returns the size of the generated C code
+size_t codeSize(Compiler *c);
+
+// writes the generated C code in the file descriptor fd
+// returns false on error
+bool writeCodeTo(Compiler *c, int fd);
+
+// writes the generated C code in a file
+// returns false if the file cannot be written
+bool writeCode(Compiler *c, const char *fileName);
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fnstate.h"
+#include "compiler.h"
+#include "utils.h"
+
+// the first line of a state file; it is followed by every function, as a line
+// "<fingerprint in hex> <code length>\n" and its code, ended with \n
+#define STATE_MAGIC "quick-state 1\n"
+
+// the max length of a function line, with its \n
+#define MAX_LINE 64
+
+static int byFingerprint(const void *a, const void *b)
+{
+	const uint64_t *x = ((const FnCode *)a)->fp, *y = ((const FnCode *)b)->fp;
+	if (x[0] != y[0])
+		return x[0] < y[0] ? -1 : 1;
+	if (x[1] != y[1])
+		return x[1] < y[1] ? -1 : 1;
+	return 0;
+}
+
+// reads the function which begins at *p and moves *p after it
+static bool readFn(const char **p, const char *end, FnCode *fn)
+{
+	const char *nl = (const char *)memchr(*p, '\n', end - *p < MAX_LINE ? end - *p : MAX_LINE);
+	if (!nl)
+		return false;
+	char line[MAX_LINE];
+	memcpy(line, *p, nl - *p);
+	line[nl - *p] = '\0';
+	unsigned long long fp0, fp1;
+	if (sscanf(line, "%16llx%16llx %zu", &fp0, &fp1, &fn->len) != 3)
+		return false;
+	fn->fp[0] = fp0;
+	fn->fp[1] = fp1;
+	fn->code = nl + 1;
+	if (fn->len >= (size_t)(end - fn->code) || fn->code[fn->len] != '\n')
+		return false;
+	*p = fn->code + fn->len + 1;
+	return true;
+}
+
+void fnStateLoad(FnState *state, const char *fileName, const uint64_t exeHash[2])
+{
+	*state = (FnState){0};
+	// the code depends on the transpiler, so its hash begins all the fingerprints
+	state->seed[0] = exeHash[0];
+	state->seed[1] = exeHash[1];
+	state->buf = tryMapFile(fileName, &state->size);
+	size_t magicLen = strlen(STATE_MAGIC);
+	if (!state->buf || state->size < magicLen || memcmp(state->buf, STATE_MAGIC, magicLen))
+		return;
+	const char *p = state->buf + magicLen, *end = state->buf + state->size;
+	int cap = 0;
+	while (p < end)
+	{
+		if (state->n == cap)
+		{
+			cap = cap ? cap * 2 : 64;
+			FnCode *fns = (FnCode *)realloc(state->fns, cap * sizeof(FnCode));
+			if (!fns)
+				err("not enough memory");
+			state->fns = fns;
+		}
+		if (!readFn(&p, end, &state->fns[state->n]))
+		{
+			state->n = 0; // a damaged file is not used at all
+			break;
+		}
+		state->n++;
+	}
+	qsort(state->fns, state->n, sizeof(FnCode), byFingerprint);
+}
+
+void fnStateFree(FnState *state)
+{
+	if (state->buf)
+		unmapFile(state->buf, state->size);
+	free(state->fns);
+	*state = (FnState){0};
+}
+
+const FnCode *fnStateFind(FnState *state, const uint64_t fp[2])
+{
+	if (!state->n) // bsearch does not take a NULL array
+		return NULL;
+	FnCode key = {.fp = {fp[0], fp[1]}};
+	return (const FnCode *)bsearch(&key, state->fns, state->n, sizeof(FnCode), byFingerprint);
+}
+
+// adds to a hash the signature of the global which can be referenced by a name from a function
+// the name can also be a local of the function, then the global is added even if it is not used
+static void hashGlobal(Compiler *c, FnJob *job, int name, uint64_t h[2])
+{
+	// at the end of the program only the global domain remains, so the innermost symbol is a global
+	Symbol *s = searchSymbol(c, name);
+	if (s && s->order <= job->order) // only the globals defined before the function are visible
+	{
+		hashBytes(h, &s->kind, sizeof(s->kind));
+		hashBytes(h, &s->type, sizeof(s->type));
+		if (s->kind == KIND_FN)
+		{
+			for (int i = 0; i < s->nArgs; i++)
+				hashBytes(h, &s->args[i].type, sizeof(s->args[i].type));
+			hashBytes(h, &s->nArgs, sizeof(s->nArgs));
+		}
+		return;
+	}
+	int missing = -1;
+	hashBytes(h, &missing, sizeof(missing));
+}
+
+void fnFingerprint(Compiler *c, FnJob *job)
+{
+	uint64_t h[2] = {c->prevFns->seed[0], c->prevFns->seed[1]};
+	for (int i = job->firstTk; i < job->endTk; i++)
+	{
+		unsigned char code = tkCode(&c->tokens, i);
+		hashBytes(h, &code, 1);
+		if (code == ID || code == STR)
+		{
+			// the interned ids change between compilations, so their chars are used
+			int id = tkId(&c->tokens, i);
+			size_t len = internLen(c->strings, id);
+			hashBytes(h, &len, sizeof(len));
+			hashBytes(h, internChars(c->strings, id), len);
+			if (code == ID)
+				hashGlobal(c, job, id, h);
+		}
+		else if (code == INT)
+		{
+			int v = tkInt(&c->tokens, i);
+			hashBytes(h, &v, sizeof(v));
+		}
+		else if (code == REAL)
+		{
+			double v = tkReal(&c->tokens, i);
+			hashBytes(h, &v, sizeof(v));
+		}
+	}
+	job->fp[0] = h[0];
+	job->fp[1] = h[1];
+}
+
+bool fnStateSave(Compiler *c, const char *fileName)
+{
+	size_t len = strlen(fileName) + sizeof(".XXXXXX");
+	char *tmp = (char *)safeAlloc(len);
+	snprintf(tmp, len, "%s.XXXXXX", fileName);
+	int fd = mkstemp(tmp);
+	FILE *fis = fd >= 0 ? fdopen(fd, "w") : NULL;
+	if (!fis)
+	{
+		if (fd >= 0)
+			close(fd);
+		free(tmp);
+		return false;
+	}
+	fputs(STATE_MAGIC, fis);
+	bool ok = true;
+	for (int i = 0; i < c->nFnJobs; i++)
+	{
+		FnJob *job = &c->fnJobs[i];
+		size_t len = job->spilled ? job->spillLen : job->code.n;
+		fprintf(fis, "%016llx%016llx %zu\n", (unsigned long long)job->fp[0], (unsigned long long)job->fp[1], len);
+		if (job->spilled)
+			ok = spillCopy(&c->functionsSpill, job->spillPos, len, fis) && ok;
+		else
+			fwrite(job->code.buf, 1, len, fis);
+		fputc('\n', fis);
+	}
+	ok = !ferror(fis) && ok;
+	ok = !fclose(fis) && ok;
+	ok = ok && rename(tmp, fileName) == 0;
+	if (!ok)
+		unlink(tmp);
+	free(tmp);
+	return ok;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The code generated for every function of a file, kept in a state file between compilations,
+// so that only the changed functions are compiled again.
+// Every function is identified by its fingerprint, a hash of its tokens and of the signatures
+// of the globals and functions it can reference. If the fingerprint of a function is found
+// in the state of the previous compilation, its code is taken from there without compiling it.
+// The fingerprints do not depend on lines, so moving a function does not change its code.
+
+typedef struct Compiler Compiler;
+typedef struct FnJob FnJob;
+
+// the code of a function from the state file
+typedef struct
+{
+	uint64_t fp[2]; // its fingerprint
+	const char *code;
+	size_t len;
+} FnCode;
+
+typedef struct
+{
+	FnCode *fns; // sorted by fingerprint
+	int n;
+	uint64_t seed[2]; // the hash of the transpiler, the beginning of all the fingerprints
+	const char *buf;  // the mapped state file
+	size_t size;
+} FnState;
+
+// loads the state from a file, written by fnStateSave at a previous compilation
+// exeHash is the hash of the transpiler (see hashExe), computed once for all the files
+// if the file does not exist or is not valid, the state is empty, so all the functions are compiled
+void fnStateLoad(FnState *state, const char *fileName, const uint64_t exeHash[2]);
+
+// frees the memory of the state
+void fnStateFree(FnState *state);
+
+// computes the fingerprint of a function job, at the end of the program, when all its globals are known
+void fnFingerprint(Compiler *c, FnJob *job);
+
+// returns the code of the function with the given fingerprint or NULL if it is not in the state
+const FnCode *fnStateFind(FnState *state, const uint64_t fp[2]);
+
+// writes the fingerprints and the code of all the function jobs of a compiler in a state file
+// the file is replaced atomically, so a failed write leaves the old state
+// returns false on error
+bool fnStateSave(Compiler *c, const char *fileName);
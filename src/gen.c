@@ -1,36 +1,73 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "lexer.h"
 #include "ad.h"
+#include "ast.h"
+#include "compiler.h"
 #include "gen.h"
+#include "intern.h"
 
-Text tBegin, tMain, tFunctions, tFnHeader;
-Text *crtCode;
-Text *crtVar;
+// the growth policy of the buffers, which can be changed for benchmarks, ex: make TEXT_GROWTH=2
+#ifndef TEXT_MIN_CAP
+#define TEXT_MIN_CAP 256 // the size of a buffer at its first write
+#endif
+#ifndef TEXT_GROWTH
+#define TEXT_GROWTH 1.5 // when a buffer is full, its size is multiplied by this, or more if needed
+#endif
 
-void Text_write(Text *text, const char *fmt, ...)
+// makes room in the buffer for another len chars and their \0
+static void Text_reserve(Text *text, size_t len)
 {
-	va_list va;
-	va_start(va, fmt); // "va" is an iterator to the variable list of arguments
-	// vsnprintf called with buffer==NULL, or max nb. of chars==0
-	// returns the total number of chars, without \0, which will be written
-	// if there is a suitable sized buffer
-	int n = vsnprintf(NULL, 0, fmt, va);
-	// realloc the dynamic buffer to add the new chars
-	char *p = (char *)realloc(text->buf, (text->n + n + 1) * sizeof(char));
+	if (text->n + len < text->cap)
+		return;
+	size_t cap = (size_t)(text->cap * TEXT_GROWTH);
+	if (cap < TEXT_MIN_CAP)
+		cap = TEXT_MIN_CAP;
+	if (cap <= text->n + len)
+		cap = text->n + len + 1;
+	char *p = (char *)realloc(text->buf, cap * sizeof(char));
 	if (p == NULL)
 	{
 		puts("not enough memory");
 		exit(EXIT_FAILURE);
 	}
-	// adds the new chars to the dynamic buffer
-	va_start(va, fmt); // resets the iterator in the variable list of arguments
-	vsnprintf(p + text->n, n + 1, fmt, va);
 	text->buf = p;
-	text->n += n;
+	text->cap = cap;
+}
+
+void Text_write(Text *text, const char *fmt, ...)
+{
+	if (!text->buf)
+		Text_reserve(text, 0);
+	va_list va;
+	va_start(va, fmt); // "va" is an iterator to the variable list of arguments
+	// the chars are formatted directly in the free space of the buffer
+	// vsnprintf returns the total number of chars, without \0, even if they do not fit
+	size_t room = text->cap - text->n;
+	int n = vsnprintf(text->buf + text->n, room, fmt, va);
 	va_end(va);
+	if (n < 0)
+		return;
+	if ((size_t)n >= room)
+	{
+		// only when the chars do not fit, the buffer grows and they are formatted again
+		Text_reserve(text, n);
+		va_start(va, fmt); // resets the iterator in the variable list of arguments
+		vsnprintf(text->buf + text->n, n + 1, fmt, va);
+		va_end(va);
+	}
+	text->n += n;
+}
+
+void Text_append(Text *text, const char *chars, size_t len)
+{
+	Text_reserve(text, len);
+	memcpy(text->buf + text->n, chars, len);
+	text->n += len;
+	text->buf[text->n] = '\0';
 }
 
 void Text_clear(Text *text)
@@ -38,6 +75,14 @@ void Text_clear(Text *text)
 	free(text->buf);
 	text->buf = NULL;
 	text->n = 0;
+	text->cap = 0;
+}
+
+void Text_reset(Text *text)
+{
+	text->n = 0;
+	if (text->buf)
+		text->buf[0] = '\0';
 }
 
 const char *cType(int type)
@@ -55,3 +100,185 @@ const char *cType(int type)
 		exit(EXIT_FAILURE);
 	}
 }
+
+// the C precedence of an expression, used to put parentheses only where they are needed
+// a higher value binds stronger
+int cPrec(Compiler *c, int node)
+{
+	Node *n = NODE(&c->ast, node);
+	switch (n->kind)
+	{
+	case N_ASSIGN:
+		return 2;
+	case N_UNARY:
+		return 14;
+	case N_BINARY:
+		switch (n->op)
+		{
+		case OR:
+			return 4;
+		case AND:
+			return 5;
+		case EQUAL:
+			return 9;
+		case LESS:
+			return 10;
+		case ADD:
+		case SUB:
+			return 12;
+		default: // MUL, DIV
+			return 13;
+		}
+	default:
+		return 16;
+	}
+}
+
+void genExpr(Compiler *c, int node, int minPrec);
+
+// generates a list of expressions separated by ","
+void genArgs(Compiler *c, int first)
+{
+	for (int arg = first; arg != NO_NODE; arg = NODE(&c->ast, arg)->next)
+	{
+		if (arg != first)
+			Text_write(c->crtCode, ",");
+		genExpr(c, arg, 0);
+	}
+}
+
+// generates an expression, inside parentheses if its precedence is lower than minPrec
+void genExpr(Compiler *c, int node, int minPrec)
+{
+	Node *n = NODE(&c->ast, node);
+	int prec = cPrec(c, node);
+	if (prec < minPrec)
+		Text_write(c->crtCode, "(");
+	switch (n->kind)
+	{
+	case N_INT:
+		Text_write(c->crtCode, "%d", n->val.i);
+		break;
+	case N_REAL:
+		Text_write(c->crtCode, "%g", n->val.r);
+		break;
+	case N_STR:
+		Text_write(c->crtCode, "\"%s\"", internText(c->strings, n->val.id));
+		break;
+	case N_ID:
+		Text_write(c->crtCode, "%s", internText(c->strings, n->val.id));
+		break;
+	case N_CALL:
+		Text_write(c->crtCode, "%s(", internText(c->strings, n->val.id));
+		genArgs(c, n->a);
+		Text_write(c->crtCode, ")");
+		break;
+	case N_ASSIGN:
+		genExpr(c, n->a, prec + 1);
+		Text_write(c->crtCode, "=");
+		genExpr(c, n->b, prec);
+		break;
+	case N_BINARY:
+		// all the binary operators are left associative
+		genExpr(c, n->a, prec);
+		Text_write(c->crtCode, "%s", ATOMS_SPELLING[n->op]);
+		genExpr(c, n->b, prec + 1);
+		break;
+	case N_UNARY:
+		// a space avoids to generate "--" from "a - -b"
+		if (n->op == SUB && c->crtCode->n && c->crtCode->buf[c->crtCode->n - 1] == '-')
+			Text_write(c->crtCode, " ");
+		Text_write(c->crtCode, "%s", ATOMS_SPELLING[n->op]);
+		genExpr(c, n->a, prec + 1);
+		break;
+	}
+	if (prec < minPrec)
+		Text_write(c->crtCode, ")");
+}
+
+void genInstrs(Compiler *c, int first);
+
+void genInstr(Compiler *c, int node)
+{
+	Node *n = NODE(&c->ast, node);
+	switch (n->kind)
+	{
+	case N_IF:
+		Text_write(c->crtCode, "if(");
+		genExpr(c, n->a, 0);
+		Text_write(c->crtCode, "){\n");
+		genInstrs(c, n->b);
+		Text_write(c->crtCode, "}\n");
+		if (n->c != NO_NODE)
+		{
+			Text_write(c->crtCode, "else{\n");
+			genInstrs(c, n->c);
+			Text_write(c->crtCode, "}\n");
+		}
+		break;
+	case N_WHILE:
+		Text_write(c->crtCode, "while(");
+		genExpr(c, n->a, 0);
+		Text_write(c->crtCode, "){\n");
+		genInstrs(c, n->b);
+		Text_write(c->crtCode, "}\n");
+		break;
+	case N_RETURN:
+		Text_write(c->crtCode, "return ");
+		genExpr(c, n->a, 0);
+		Text_write(c->crtCode, ";\n");
+		break;
+	case N_EXPR:
+		genExpr(c, n->a, 0);
+		Text_write(c->crtCode, ";\n");
+		break;
+	}
+}
+
+void genInstrs(Compiler *c, int first)
+{
+	for (int node = first; node != NO_NODE; node = NODE(&c->ast, node)->next)
+		genInstr(c, node);
+}
+
+void genVar(Compiler *c, int node)
+{
+	Node *n = NODE(&c->ast, node);
+	Text_write(c->crtVar, "%s %s;\n", cType(n->declType), internText(c->strings, n->val.id));
+}
+
+void genFunc(Compiler *c, int node)
+{
+	Node *n = NODE(&c->ast, node);
+	c->crtCode = &c->tFunctions;
+	c->crtVar = &c->tFunctions;
+	Text_write(&c->tFunctions, "\n%s %s(", cType(n->declType), internText(c->strings, n->val.id));
+	for (int param = n->a; param != NO_NODE; param = NODE(&c->ast, param)->next)
+	{
+		if (param != n->a)
+			Text_write(&c->tFunctions, ",");
+		Text_write(&c->tFunctions, "%s %s", cType(NODE(&c->ast, param)->declType), internText(c->strings, NODE(&c->ast, param)->val.id));
+	}
+	Text_write(&c->tFunctions, "){\n");
+	for (int var = n->b; var != NO_NODE; var = NODE(&c->ast, var)->next)
+		genVar(c, var);
+	genInstrs(c, n->c);
+	Text_write(&c->tFunctions, "}\n");
+	c->crtCode = &c->tMain;
+	c->crtVar = &c->tBegin;
+}
+
+void genItem(Compiler *c, int node)
+{
+	switch (NODE(&c->ast, node)->kind)
+	{
+	case N_VAR:
+		genVar(c, node);
+		break;
+	case N_FUNC:
+		genFunc(c, node);
+		break;
+	default:
+		genInstr(c, node);
+	}
+}
@@ -3,33 +3,34 @@
 #include <stddef.h>
 
 // A simple implementation of a dynamic buffer in which chars are written.
-// As chars are written, the buffer will grow.
+// As chars are written, the buffer will grow geometrically, so its memory is reallocated
+// only a logarithmic number of times (see TEXT_GROWTH in gen.c).
 typedef struct
 {
-	char *buf; // buffer
-	size_t n;  // nr de caractere din buf
+	char *buf;	// buffer, ended with \0 if it is not NULL
+	size_t n;	// nr de caractere din buf
+	size_t cap; // the size of buf, always > n when buf is not NULL
 } Text;
 
 // Same as printf, but the chars are written in the "text" buffer, not on screen.
 void Text_write(Text *text, const char *fmt, ...);
 
+// Appends len chars to the buffer, without formatting them.
+void Text_append(Text *text, const char *chars, size_t len);
+
 // Deletes the chars from a buffer
 void Text_clear(Text *text);
 
-extern Text tBegin // for header file and global variabiles
-	 ,
-	 tMain // the Quick global code, which will be considered as the body of the C main function
-	 ,
-	 tFunctions // the functions from Quick
-	 ,
-	 tFnHeader // used temporarily at the function header generation
-	 ;
+// Deletes the chars from a buffer, but keeps its memory for the next writes
+void Text_reset(Text *text);
 
-// these pointers will point to different buffers
-// depending on the current domain (in a function or global)
-extern Text *crtCode; // if in a function, it points to tFunctions, else to tMain
-extern Text *crtVar;	 // if in a function, it points to tFunctions, else to tBegin
+// the buffers with the generated code are kept in the Compiler (see compiler.h)
+typedef struct Compiler Compiler;
 
 // returns the C name for a Quick type (ex: TYPE_REAL -> double)
 // type = TYPE_*
 const char *cType(int type);
+
+// generates the C code for a top level item from the AST (a variable, a function or an instruction)
+// the types analysis must be done before, with checkItem
+void genItem(Compiler *c, int node);
@@ -0,0 +1,217 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "intern.h"
+#include "utils.h"
+
+typedef struct Interned Interned;
+struct Interned
+{
+	const char *chars; // the chars, possibly a span without \0 in a buffer owned by the caller
+	const char *text;	 // the \0 ended chars or NULL if they were not needed yet
+	size_t len;
+	unsigned hash;
+};
+
+// the chars are stored in blocks which are never reallocated, so the returned texts are stable
+#define BLOCK_SIZE (64 * 1024)
+
+typedef struct Block Block;
+struct Block
+{
+	Block *prev;
+	size_t n;	 // nr of used chars
+	size_t cap; // nr of allocated chars
+	char chars[];
+};
+
+static char *storeChars(Interner *in, const char *begin, size_t len)
+{
+	Block *crt = in->block;
+	if (!crt || crt->n + len + 1 > crt->cap)
+	{
+		size_t cap = len + 1 > BLOCK_SIZE ? len + 1 : BLOCK_SIZE;
+		Block *b = (Block *)safeAlloc(sizeof(Block) + cap);
+		b->prev = crt;
+		b->n = 0;
+		b->cap = cap;
+		in->block = crt = b;
+	}
+	char *p = crt->chars + crt->n;
+	memcpy(p, begin, len);
+	p[len] = '\0';
+	crt->n += len + 1;
+	return p;
+}
+
+static void growSlots(Interner *in)
+{
+	unsigned cap = in->capSlots ? in->capSlots * 2 : 1024;
+	int *newSlots = (int *)safeAlloc(cap * sizeof(int));
+	memset(newSlots, -1, cap * sizeof(int));
+	for (int id = 0; id < in->n; id++)
+	{
+		unsigned i = in->entries[id].hash & (cap - 1);
+		while (newSlots[i] >= 0)
+			i = (i + 1) & (cap - 1);
+		newSlots[i] = id;
+	}
+	free(in->slots);
+	in->slots = newSlots;
+	in->capSlots = cap;
+}
+
+// makes room for at least n strings
+static void reserveEntries(Interner *in, int n)
+{
+	int cap = in->cap ? in->cap : 1024;
+	while (cap < n)
+		cap *= 2;
+	if (cap == in->cap)
+		return;
+	Interned *p = (Interned *)realloc(in->entries, cap * sizeof(Interned));
+	if (!p)
+		err("not enough memory");
+	in->entries = p;
+	in->cap = cap;
+}
+
+void internSeed(Interner *in, const char *const *texts, const size_t *lens, const unsigned *hashes, int n)
+{
+	if (in->n)
+		err("only an empty table can be seeded");
+	while ((unsigned)n * 2 > in->capSlots)
+		growSlots(in);
+	reserveEntries(in, n);
+	for (int id = 0; id < n; id++)
+	{
+		in->entries[id] = (Interned){.chars = texts[id], .text = texts[id], .len = lens[id], .hash = hashes[id]};
+		unsigned i = hashes[id] & (in->capSlots - 1);
+		while (in->slots[i] >= 0)
+			i = (i + 1) & (in->capSlots - 1);
+		in->slots[i] = id;
+	}
+	in->n = n;
+}
+
+// finds the string [begin,begin+len) or adds it to the table
+// if copy is false, the table keeps only a reference to the chars
+static int add(Interner *in, const char *begin, size_t len, bool copy)
+{
+	// keeps the load factor under 1/2
+	if ((unsigned)(in->n + 1) * 2 > in->capSlots)
+		growSlots(in);
+	unsigned h = internHashOf(begin, len);
+	unsigned i = h & (in->capSlots - 1);
+	for (; in->slots[i] >= 0; i = (i + 1) & (in->capSlots - 1))
+	{
+		Interned *e = &in->entries[in->slots[i]];
+		if (e->hash == h && e->len == len && memcmp(e->chars, begin, len) == 0)
+			return in->slots[i];
+	}
+	if (in->n == in->cap)
+		reserveEntries(in, in->n + 1);
+	int id = in->n++;
+	Interned *e = &in->entries[id];
+	if (copy)
+	{
+		e->text = e->chars = storeChars(in, begin, len);
+	}
+	else
+	{
+		e->chars = begin;
+		e->text = NULL;
+	}
+	e->len = len;
+	e->hash = h;
+	in->slots[i] = id;
+	return id;
+}
+
+int intern(Interner *in, const char *begin, size_t len)
+{
+	return add(in, begin, len, true);
+}
+
+int internSpan(Interner *in, const char *begin, size_t len)
+{
+	return add(in, begin, len, false);
+}
+
+int internStr(Interner *in, const char *str)
+{
+	return intern(in, str, strlen(str));
+}
+
+const char *internText(Interner *in, int id)
+{
+	Interned *e = &in->entries[id];
+	if (!e->text)
+		e->text = storeChars(in, e->chars, e->len);
+	return e->text;
+}
+
+void internTexts(Interner *in)
+{
+	for (int id = 0; id < in->n; id++)
+		internText(in, id);
+}
+
+const char *internChars(Interner *in, int id)
+{
+	return in->entries[id].chars;
+}
+
+size_t internLen(Interner *in, int id)
+{
+	return in->entries[id].len;
+}
+
+unsigned internHash(Interner *in, int id)
+{
+	return in->entries[id].hash;
+}
+
+InternMark internMark(Interner *in)
+{
+	return (InternMark){in->n, in->block, in->block ? in->block->n : 0};
+}
+
+void internRelease(Interner *in, InternMark mark)
+{
+	while (in->block != mark.block)
+	{
+		Block *prev = in->block->prev;
+		free(in->block);
+		in->block = prev;
+	}
+	if (in->block)
+		in->block->n = mark.blockN;
+	in->n = mark.n;
+	// the remaining strings are put again in the emptied slots
+	if (in->capSlots)
+		memset(in->slots, -1, in->capSlots * sizeof(int));
+	for (int id = 0; id < in->n; id++)
+	{
+		Interned *e = &in->entries[id];
+		if (e->text != e->chars) // the \0 ended copy of a span could be in a deleted block
+			e->text = NULL;
+		unsigned i = e->hash & (in->capSlots - 1);
+		while (in->slots[i] >= 0)
+			i = (i + 1) & (in->capSlots - 1);
+		in->slots[i] = id;
+	}
+}
+
+void internFree(Interner *in)
+{
+	for (Block *b = in->block, *prev; b; b = prev)
+	{
+		prev = b->prev;
+		free(b);
+	}
+	free(in->entries);
+	free(in->slots);
+	*in = (Interner){0};
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+
+// The table of interned strings (atoms).
+// Every distinct string is stored only once and gets a stable id, so two strings
+// are equal if and only if their ids are equal. The hash of every string is computed
+// only once, when it is interned. The chars of an interned string never move in memory.
+// Every compilation has its own table, so the ids are valid only in the table which returned them.
+
+// a table of interned strings, empty when it is zero initialized
+typedef struct
+{
+	struct Interned *entries; // all the interned strings, indexed by their id
+	int n, cap;
+	int *slots;				  // open addressing hash table with the ids, -1 for an empty slot
+	unsigned capSlots;		  // power of 2
+	struct Block *block;	  // the last block of chars
+} Interner;
+
+// the state of a table at some moment, to delete later all the strings added after it
+typedef struct
+{
+	int n;				 // the number of strings
+	struct Block *block; // the last block of chars and its number of used chars
+	size_t blockN;
+} InternMark;
+
+// the hash of an interned string (FNV-1a)
+// it is also used at build time, to generate the hashes of the static strings (see internSeed)
+static inline unsigned internHashOf(const char *begin, size_t len)
+{
+	unsigned h = 2166136261u;
+	for (size_t i = 0; i < len; i++)
+	{
+		h ^= (unsigned char)begin[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+// adds n distinct static strings to an empty table, with the ids 0..n-1
+// their lengths and hashes (from internHashOf) are known at build time, so they are not computed
+// and the table keeps only a reference to the texts, which must be ended with \0
+void internSeed(Interner *in, const char *const *texts, const size_t *lens, const unsigned *hashes, int n);
+
+// returns the id of the string [begin,begin+len), adding it to the table if it is new
+// the chars are copied in the table
+int intern(Interner *in, const char *begin, size_t len);
+
+// same as intern, but the table only keeps a reference to [begin,begin+len), without copying it
+// the chars must remain valid and unchanged as long as the table is used (ex: a span in the mapped source file)
+// a \0 ended copy is made only if internText is called for it
+int internSpan(Interner *in, const char *begin, size_t len);
+
+// same as intern, for a string ended with \0
+int internStr(Interner *in, const char *str);
+
+// returns the chars of an interned string, ended with \0
+const char *internText(Interner *in, int id);
+
+// makes the \0 ended texts of all the strings, so after it internText only reads the table
+// and it can be called from several threads, as long as no string is added
+void internTexts(Interner *in);
+
+// returns the chars of an interned string, without a \0 at the end (use it with internLen)
+const char *internChars(Interner *in, int id);
+
+// returns the length of an interned string
+size_t internLen(Interner *in, int id);
+
+// returns the hash of an interned string
+unsigned internHash(Interner *in, int id);
+
+// returns the current state of the table, for internRelease
+InternMark internMark(Interner *in);
+
+// deletes all the strings added after the mark, keeping the ids of the older ones
+// the memory of the table is kept for the next strings, except the blocks of chars added after the mark
+void internRelease(Interner *in, InternMark mark);
+
+// frees all the memory of the table and empties it
+void internFree(Interner *in);
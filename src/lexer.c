@@ -2,252 +2,282 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+#include <setjmp.h>
 
 #include "lexer.h"
 #include "utils.h"
+#include "intern.h"
+#include "scan.h"
+#include "pool.h"
+#include "keywords.inc"
+#include "operators.inc"
 
-Token tokens[MAX_TOKENS];
-int nTokens;
+// prints an error message with the current line and exit the program
+// or, if the lexer has an error handler, saves the message and jumps to the handler
+_Noreturn static void lexErr(Lexer *lx, const char *fmt, ...)
+{
+	va_list va;
+	va_start(va, fmt);
+	vsnprintf(lx->errMsg, MAX_ERR, fmt, va);
+	va_end(va);
+	lx->errLine = lx->line;
+	if (lx->onErr)
+		longjmp(*lx->onErr, 1);
+	fprintf(stderr, "error in line %d: %s\n", lx->errLine, lx->errMsg);
+	exit(EXIT_FAILURE);
+}
 
-int line = 1; // the current line in the input file
+static void reserveTks(Tokens *tks, int cap);
 
-// adds a token to the end of the tokens list and returns it
+// adds a token to the end of the tokens list and returns its index in the tokens arrays
 // sets its code and line
-Token *addTk(int code)
+int addTk(Lexer *lx, int code)
+{
+	Tokens *tks = lx->tks;
+	if (tks->stream)
+	{
+		int i = tks->n++ & (TK_RING - 1);
+		if (tks->n > TK_RING)
+			tks->first = tks->n - TK_RING;
+		tks->code[i] = (unsigned char)code;
+		tks->line[i] = lx->line;
+		return i;
+	}
+	if (tks->n == tks->cap)
+		reserveTks(tks, tks->cap ? tks->cap * 2 : 1024);
+	int i = tks->n++;
+	tks->code[i] = (unsigned char)code;
+	tks->line[i] = lx->line;
+	return i;
+}
+
+// sets the value of the ID or STR token tk from the string between [begin,end)
+// only a span into the source is kept, the chars are not copied
+void addText(Lexer *lx, int tk, const char *begin, const char *end)
+{
+	if (lx->spans)
+	{
+		lx->tks->val[tk].span.offset = (unsigned)(begin - lx->src);
+		lx->tks->val[tk].span.len = (unsigned)(end - begin);
+	}
+	else
+	{
+		lx->tks->val[tk].id = internSpan(lx->tks->strings, begin, (size_t)(end - begin));
+	}
+}
+
+const char *tkText(Tokens *tks, int i)
 {
+	if (tkCode(tks, i) == ID || tkCode(tks, i) == STR)
+		return internText(tks->strings, tkId(tks, i));
+	return ATOMS_CODE_NAME[tkCode(tks, i)];
+}
 
-	if (nTokens == MAX_TOKENS)
-		err("too many tokens");
-	Token *tk = &tokens[nTokens];
-	tk->code = code;
-	tk->line = line;
-	nTokens++;
-	return tk;
+// returns the code of the keyword from [begin,begin+len) or ID if it is not a keyword
+// uses the perfect hash generated from KEYWORDS, so only one candidate is compared
+static inline int keywordCode(const char *begin, size_t len)
+{
+	if (len > KW_MAX_LEN)
+		return ID;
+	int h = KW_HASH(len, begin[0], begin[len - 1]);
+	if (kwTable[h].len == len && memcmp(kwTable[h].text, begin, len) == 0)
+		return kwTable[h].code;
+	return ID;
 }
 
-// copy in the dst buffer the string between [begin,end)
-char *copyn(char *dst, const char *begin, const char *end)
+// powers of 10 which are exactly representable as double
+static const double exactPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+												1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// the value of a REAL which cannot be computed exactly from its first 19 significant digits
+// strtod rounds it correctly; the number is copied so strtod sees only [begin,end)
+static double slowReal(Lexer *lx, const char *begin, const char *end)
 {
-	char *p = dst;
-	if (end - begin > MAX_STR)
-		err("string too long");
-	while (begin != end)
-		*p++ = *begin++;
-	*p = '\0';
-	return dst;
+	char small[64];
+	size_t len = (size_t)(end - begin);
+	char *buf = len < sizeof(small) ? small : (char *)safeAlloc(len + 1);
+	memcpy(buf, begin, len);
+	buf[len] = '\0';
+	errno = 0;
+	double r = strtod(buf, NULL);
+	if (buf != small)
+		free(buf);
+	if (errno == ERANGE && (r == HUGE_VAL || r == 0))
+		lexErr(lx, "the real number %.*s is out of range", (int)len, begin);
+	return r;
 }
 
-void tokenize(const char *pch)
+// scans an INT or a REAL from p, adds its token and returns the position after it
+// the value is built while the digits are scanned, so the number is read only once
+// *tk is set to the token index in the tokens arrays
+static const char *lexNumber(Lexer *lx, const char *p, int *tk)
 {
+	const char *begin = p;
+	uint64_t m = 0;	// the first 19 significant digits, which always fit in 64 bits
+	int nDigits = 0;	// nr of significant digits in m
+	int nFrac = 0;		// nr of digits after '.' in m
+	bool exact = true; // if m has all the significant digits
+
+	for (unsigned d; (d = (unsigned char)*p - '0') <= 9; p++)
+	{
+		if (nDigits < 19)
+		{
+			m = m * 10 + d;
+			if (m)
+				nDigits++;
+		}
+		else
+		{
+			exact = false;
+		}
+	}
+
+	if (*p != '.')
+	{
+		if (!exact || m > INT_MAX)
+			lexErr(lx, "the int number %.*s is too big", (int)(p - begin), begin);
+		*tk = addTk(lx, INT);
+		lx->tks->val[*tk].i = (int)m;
+		return p;
+	}
+
+	for (unsigned d; (d = (unsigned char)*++p - '0') <= 9;)
+	{
+		if (nDigits < 19)
+		{
+			m = m * 10 + d;
+			if (m)
+				nDigits++;
+			nFrac++;
+		}
+		else
+		{
+			exact = false;
+		}
+	}
+
+	double r;
+	// m and 10^nFrac are exact doubles, so their division is correctly rounded
+	if (exact && m <= (1ull << 53) && nFrac <= 22)
+		r = (double)m / exactPow10[nFrac];
+	else
+		r = slowReal(lx, begin, p);
+	*tk = addTk(lx, REAL);
+	lx->tks->val[*tk].r = r;
+	return p;
+}
+
+// the runs of blanks or identifier chars are scanned here for up to this many chars,
+// and only the longer ones by the kernels, because most runs are short and for them
+// the call of a kernel costs more than it saves
+#define SHORT_RUN 8
+
+// skips ' ', '\t' and '\n' like scanner->spaces
+static inline const char *skipSpaces(const char *p, int *line)
+{
+	for (const char *end = p + SHORT_RUN; p < end; p++)
+	{
+		if (*p == '\n')
+			(*line)++;
+		else if (*p != ' ' && *p != '\t')
+			return p;
+	}
+	return scanner->spaces(p, line);
+}
+
+// skips [a-zA-Z0-9_] like scanner->ident
+static inline const char *skipIdent(const char *p)
+{
+	for (const char *end = p + SHORT_RUN; p < end; p++)
+	{
+		if (!isalnum((unsigned char)*p) && *p != '_')
+			return p;
+	}
+	return scanner->ident(p);
+}
+
+// lexes the next token from lx->pch
+// returns false if lx->end was reached before a new token
+static bool lexTk(Lexer *lx)
+{
+	const char *pch = lx->pch;
 	const char *start;
-	Token *tk;
-	char buf[MAX_STR + 1];
+	int tk;
+	int n = lx->tks->n;
 	for (;;)
 	{
+		if (lx->end && pch >= lx->end)
+		{
+			lx->pch = pch;
+			return false;
+		}
 		switch (*pch)
 		{
 		case ' ':
 		case '\t':
-			pch++;
+		case '\n':
+			start = pch;
+			pch = skipSpaces(pch, &lx->line);
+			if (lx->end && pch > lx->end)
+			{
+				// the blanks after end belong to the next chunk, which counts their newlines
+				for (const char *p = lx->end; p < pch; p++)
+					lx->line -= *p == '\n';
+				pch = lx->end;
+			}
 			break;
 		case '\r': // handles different kinds of newlines (Windows: \r\n, Linux: \n, MacOS, OS X: \r or \n)
 			if (pch[1] == '\n')
 				pch++;
-			// fallthrough to \n
-		case '\n':
-			line++;
+			lx->line++;
 			pch++;
 			break;
-		case '\0':
-			addTk(FINISH);
-			return;
+		case '\0': // pch is not advanced, so any further call adds another FINISH
+			// a chunk ends at lx->end, so a '\0' before it is inside the source
+			if (lx->end || (lx->srcEnd && pch < lx->srcEnd))
+				lexErr(lx, "invalid char: \\0 (0)");
+			addTk(lx, FINISH);
+			lx->pch = pch;
+			return true;
 		case '#':
-			while (*pch != '\n' && *pch != '\r' && *pch != '\0')
-			{
-				pch++;
-			};
-			break;
-		case ',':
-			addTk(COMMA);
-			pch++;
+			pch = scanner->lineEnd(pch);
 			break;
-		case ':':
-			addTk(COLON);
-			pch++;
-			break;
-		case ';':
-			addTk(SEMICOLON);
-			pch++;
-			break;
-		case '(':
-			addTk(LPAR);
-			pch++;
-			break;
-		case ')':
-			addTk(RPAR);
-			pch++;
-			break;
-		case '+':
-			addTk(ADD);
-			pch++;
-			break;
-		case '-':
-			addTk(SUB);
-			pch++;
-			break;
-		case '*':
-			addTk(MUL);
-			pch++;
-			break;
-		case '/':
-			addTk(DIV);
-			pch++;
-			break;
-		case '<':
-			if (*(pch + 1) == '=')
-			{
-				addTk(LESSEQ);
-				pch += 2;
-			}
-			else
-			{
-				addTk(LESS);
-				pch++;
-			}
-			break;
-		case '>':
-			if (*(pch + 1) == '=')
-			{
-				addTk(GREATERQ);
-				pch += 2;
-			}
-			else
-			{
-				addTk(GREATER);
-				pch++;
-			}
-			break;
-		case '|':
-			if (*(pch + 1) == '|')
-			{
-				addTk(OR);
-				pch += 2;
-			}
-			else
-			{
-				err("unrecognized signed after '|' character");
-			}
-			break;
-		case '&':
-			if (*(pch + 1) == '&')
-			{
-				addTk(AND);
-				pch += 2;
-			}
-			else
-			{
-				err("unrecognized signed after '&' character");
-			}
-			break;
-		case '!':
-			if (*(pch + 1) == '=')
-			{
-				addTk(NOTEQ);
-				pch += 2;
-			}
-			else
-			{
-				addTk(NOT);
-				pch++;
-			}
-			break;
-		case '=':
-			if (*(pch + 1) == '=')
-			{
-				addTk(EQUAL);
-				pch += 2;
-			}
-			else
+		default:
+			if (opNext[0][(unsigned char)*pch])
 			{
-				addTk(ASSIGN);
-				pch++;
+				// delimiters and operators: follows the generated DFA as long as possible
+				start = pch;
+				int state = 0;
+				for (int next; (next = opNext[state][(unsigned char)*pch]) != 0; state = next)
+					pch++;
+				if (opAccept[state] < 0)
+					lexErr(lx, "unrecognized sign after '%.*s'", (int)(pch - start), start);
+				addTk(lx, opAccept[state]);
 			}
-			break;
-		default:
-			if (isalpha(*pch) || *pch == '_')
+			else if (isalpha(*pch) || *pch == '_')
 			{
-				for (start = pch++; isalnum(*pch) || *pch == '_'; pch++)
-					;
-				char *text = copyn(buf, start, pch);
-				if (strcmp(text, "int") == 0) /**< Could implement The Knuth-Morris-Pratt algorithm for finding small lexical error when writing predefined identifiers, like itn -> int*/
-					addTk(TYPE_INT);
-				else if (strcmp(text, "real") == 0)
-				{
-					addTk(TYPE_REAL);
-				}
-				else if (strcmp(text, "str") == 0)
-				{
-					addTk(TYPE_STR);
-				}
-				else if (strcmp(text, "var") == 0)
-				{
-					addTk(VAR);
-				}
-				else if (strcmp(text, "function") == 0)
-				{
-					addTk(FUNCTION);
-				}
-				else if (strcmp(text, "if") == 0)
-				{
-					addTk(IF);
-				}
-				else if (strcmp(text, "else") == 0)
-				{
-					addTk(ELSE);
-				}
-				else if (strcmp(text, "while") == 0)
-				{
-					addTk(WHILE);
-				}
-				else if (strcmp(text, "end") == 0)
-				{
-					addTk(END);
-				}
-				else if (strcmp(text, "return") == 0)
+				start = pch;
+				pch = skipIdent(pch + 1);
+				size_t len = (size_t)(pch - start);
+				int code = keywordCode(start, len);
+				if (code != ID)
 				{
-					addTk(RETURN);
+					addTk(lx, code);
 				}
 				else
 				{
-					tk = addTk(ID);
-					strcpy(tk->text, text);
+					tk = addTk(lx, ID);
+					addText(lx, tk, start, pch);
 				}
 			}
 			else if (isdigit(*pch))
 			{
-				start = pch;
-				do
-				{
-					pch++;
-				} while (isdigit(*pch) != 0);
-
-				if (*pch == '.')
-				{
-					do
-					{
-						pch++;
-					} while (isdigit(*pch));
-
-					char *text = copyn(buf, start, pch);
-					tk = addTk(REAL);
-					tk->r = atof(text);
-				}
-				else
-				{
-					char *text = copyn(buf, start, pch);
-					tk = addTk(INT);
-					tk->i = atoi(text);
-				}
+				pch = lexNumber(lx, pch, &tk);
 			}
 			else if (*pch == '"')
 			{
@@ -256,135 +286,270 @@ void tokenize(const char *pch)
 				{
 					pch++;
 					if (*pch == '\0')
-					{
-						err("string not ended");
-						return;
-					}
+						lexErr(lx, "string not ended");
 				} while (*pch != '"');
 
-				char *text = copyn(buf, start, pch);
-				tk = addTk(STR);
-				strcpy(tk->text, text);
+				tk = addTk(lx, STR);
+				addText(lx, tk, start, pch);
 				pch++;
 			}
 			else
-				err("invalid char: %c (%d) at line %d\n", *pch, *pch, line);
+				lexErr(lx, "invalid char: %c (%d)", *pch, *pch);
+		}
+		if (lx->tks->n != n)
+		{
+			lx->pch = pch;
+			return true;
 		}
 	}
 }
 
-void showTokens()
+// sets the arrays capacity to at least cap tokens
+static void reserveTks(Tokens *tks, int cap)
+{
+	if (tks->cap >= cap)
+		return;
+	unsigned char *codes = (unsigned char *)realloc(tks->code, cap * sizeof(unsigned char));
+	int *lines = (int *)realloc(tks->line, cap * sizeof(int));
+	TokenVal *vals = (TokenVal *)realloc(tks->val, cap * sizeof(TokenVal));
+	if (!codes || !lines || !vals)
+		err("not enough memory");
+	tks->code = codes;
+	tks->line = lines;
+	tks->val = vals;
+	tks->cap = cap;
+}
+
+void lexerInit(Lexer *lx, Tokens *tks, Interner *strings, const char *src)
+{
+	*lx = (Lexer){.src = src, .pch = src, .line = 1, .tks = tks};
+	tks->n = 0;
+	tks->first = 0;
+	tks->mask = ~0u;
+	tks->stream = false;
+	tks->strings = strings;
+	tks->lexer = NULL;
+}
+
+void tokenize(Lexer *lx)
 {
-	for (int i = 0; i < nTokens; i++)
+	do
 	{
-		Token *tk = &tokens[i];
-		printf("%d ", tk->line);
+		lexTk(lx);
+	} while (lx->tks->code[lx->tks->n - 1] != FINISH);
+}
+
+// ********************* parallel lexing *******************
 
-		switch (tk->code)
+// the inputs smaller than this are lexed serially
+#define PAR_MIN_SIZE (4 * 1024 * 1024)
+// the min size of a chunk
+#define PAR_MIN_CHUNK (1024 * 1024)
+
+// a part of the input which is lexed on its own
+typedef struct
+{
+	const char *begin, *end; // the chunk: [begin,end), it begins after a newline
+	Tokens tks;					 // its tokens, with the lines counted from 1 at the chunk begin
+	const char *stop;			 // where the lexer stopped: end, or after a token which began before end and continues after it
+	int nLines;					 // nr of newlines counted by the lexer from its start to stop
+	int lineBase;				 // nr of newlines before the lexer start, to be added to the chunk lines
+	bool failed;				 // if an error was found, saved in errMsg and errLine
+	char errMsg[MAX_ERR];
+	int errLine;
+} Chunk;
+
+typedef struct
+{
+	const char *src;
+	Chunk *chunks;
+} ParLex;
+
+// lexes the tokens which begin in [from, c->end)
+static void lexChunk(const char *src, Chunk *c, const char *from)
+{
+	jmp_buf onErr;
+	Lexer lx = {.src = src, .pch = from, .end = c->end, .line = 1, .tks = &c->tks, .spans = true, .onErr = &onErr};
+	c->tks.n = 0;
+	c->failed = false;
+	if (setjmp(onErr))
+	{
+		c->failed = true;
+		memcpy(c->errMsg, lx.errMsg, MAX_ERR);
+		c->errLine = lx.errLine;
+		lx.pch = c->end;
+	}
+	else
+	{
+		while (lexTk(&lx))
+		{
+		}
+	}
+	c->stop = lx.pch;
+	c->nLines = lx.line - 1;
+}
+
+static void freeChunks(Chunk *chunks, int nChunks)
+{
+	for (int i = 0; i < nChunks; i++)
+	{
+		free(chunks[i].tks.code);
+		free(chunks[i].tks.line);
+		free(chunks[i].tks.val);
+	}
+	free(chunks);
+}
+
+static void lexChunkTask(int i, void *arg)
+{
+	ParLex *pl = (ParLex *)arg;
+	lexChunk(pl->src, &pl->chunks[i], pl->chunks[i].begin);
+}
+
+void tokenizeParallel(Lexer *lx, size_t size, int nThreads)
+{
+	// the chunks keep the positions of ID and STR as unsigned offsets, so a larger input is lexed serially
+	if (size < PAR_MIN_SIZE || nThreads < 2 || size > UINT_MAX)
+	{
+		tokenize(lx);
+		// the lexing stops at the first '\0', so it is an error like in a chunk if it is inside the source
+		if (lx->pch < lx->src + size)
+			lexErr(lx, "invalid char: \\0 (0)");
+		return;
+	}
+	const char *src = lx->src;
+	Tokens *tks = lx->tks;
+
+	// splits the input in chunks which begin after a newline
+	size_t chunkSize = size / ((size_t)nThreads * 4);
+	if (chunkSize < PAR_MIN_CHUNK)
+		chunkSize = PAR_MIN_CHUNK;
+	int nChunks = 0;
+	Chunk *chunks = (Chunk *)safeAlloc((size / chunkSize + 1) * sizeof(Chunk));
+	for (const char *p = src, *end = src + size; p < end;)
+	{
+		const char *q = p + chunkSize < end ? (const char *)memchr(p + chunkSize, '\n', (size_t)(end - p - chunkSize)) : NULL;
+		q = q ? q + 1 : end;
+		chunks[nChunks++] = (Chunk){.begin = p, .end = q};
+		p = q;
+	}
+
+	ParLex pl = {src, chunks};
+	runParallel(nChunks, lexChunkTask, &pl, nThreads);
+
+	// Every chunk was lexed as if it began outside of a token. This is false only if the last token
+	// of the previous chunk continues in it (a string with newlines), in which case it is lexed again
+	// from the end of that token. The lines are made absolute by adding the newlines of the previous chunks.
+	const char *pos = src;
+	int nLines = 0, n = 0;
+	for (int i = 0; i < nChunks; i++)
+	{
+		Chunk *c = &chunks[i];
+		if (pos > c->begin)
+		{
+			if (pos >= c->end)
+			{
+				c->tks.n = 0;
+				c->failed = false;
+				c->nLines = 0;
+				c->stop = pos;
+			}
+			else
+			{
+				lexChunk(src, c, pos);
+			}
+		}
+		if (c->failed)
+		{
+			char errMsg[MAX_ERR];
+			memcpy(errMsg, c->errMsg, MAX_ERR);
+			lx->line = nLines + c->errLine;
+			freeChunks(chunks, nChunks);
+			lexErr(lx, "%s", errMsg);
+		}
+		c->lineBase = nLines;
+		nLines += c->nLines;
+		n += c->tks.n;
+		pos = c->stop;
+	}
+
+	// stitches the chunks tokens
+	reserveTks(tks, tks->n + n + 1);
+	for (int i = 0; i < nChunks; i++)
+	{
+		Chunk *c = &chunks[i];
+		for (int k = 0, t = tks->n; k < c->tks.n; k++, t++)
+		{
+			int code = c->tks.code[k];
+			tks->code[t] = (unsigned char)code;
+			tks->line[t] = c->tks.line[k] + c->lineBase;
+			if (code == ID || code == STR)
+				tks->val[t].id = internSpan(tks->strings, src + c->tks.val[k].span.offset, c->tks.val[k].span.len);
+			else
+				tks->val[t] = c->tks.val[k];
+		}
+		tks->n += c->tks.n;
+	}
+	freeChunks(chunks, nChunks);
+	lx->line = nLines + 1;
+	lx->pch = src + size;
+	addTk(lx, FINISH);
+}
+
+// ********************* streaming mode *******************
+
+void tokenizeLazy(Lexer *lx, size_t size)
+{
+	Tokens *tks = lx->tks;
+	lx->srcEnd = lx->src + size;
+	reserveTks(tks, TK_RING);
+	tks->stream = true;
+	tks->first = 0;
+	tks->mask = TK_RING - 1;
+	tks->lexer = lx;
+}
+
+void fetchTk(Tokens *tks, int i)
+{
+	if (i < tks->first)
+		err("the token %d is not available anymore, the parser can go back at most %d tokens", i, TK_RING - 1);
+	if (!tks->stream)
+		err("the token %d is after the end of the tokens list", i);
+	while (tks->n <= i)
+		lexTk(tks->lexer);
+}
+
+void freeTokens(Tokens *tks)
+{
+	free(tks->code);
+	free(tks->line);
+	free(tks->val);
+	tks->code = NULL;
+	tks->line = NULL;
+	tks->val = NULL;
+	tks->n = tks->cap = tks->first = 0;
+}
+
+void showTokens(Tokens *tks)
+{
+	for (int i = 0; i < tks->n; i++)
+	{
+		printf("%d ", tkLine(tks, i));
+
+		switch (tkCode(tks, i))
 		{
 		case ID:
-			printf("%s:%s\n", "ID", tk->text);
-			break;
-		case VAR:
-			printf("%s\n", "VAR");
-			break;
-		case FUNCTION:
-			printf("%s\n", "FUNCTION");
-			break;
-		case IF:
-			printf("%s\n", "IF");
-			break;
-		case ELSE:
-			printf("%s\n", "ELSE");
-			break;
-		case WHILE:
-			printf("%s\n", "WHILE");
-			break;
-		case END:
-			printf("%s\n", "END");
-			break;
-		case RETURN:
-			printf("%s\n", "RETURN");
-			break;
-		case TYPE_INT:
-			printf("%s\n", "TYPE_INT");
-			break;
-		case TYPE_REAL:
-			printf("%s\n", "TYPE_REAL");
-			break;
-		case TYPE_STR:
-			printf("%s\n", "TYPE_STR");
+		case STR:
+			printf("%s:%s\n", ATOMS_CODE_NAME[tkCode(tks, i)], tkText(tks, i));
 			break;
 		case INT:
-			printf("%s:%d\n", "INT", tk->i);
+			printf("%s:%d\n", "INT", tkInt(tks, i));
 			break;
 		case REAL:
-			printf("%s:%.5f\n", "REAL", tk->r);
-			break;
-		case STR:
-			printf("%s:%s\n", "STR", tk->text);
-			break;
-		case COMMA:
-			printf("%s\n", "COMMA");
-			break;
-		case COLON:
-			printf("%s\n", "COLON");
-			break;
-		case SEMICOLON:
-			printf("%s\n", "SEMICOLON");
-			break;
-		case LPAR:
-			printf("%s\n", "LPAR");
-			break;
-		case RPAR:
-			printf("%s\n", "RPAR");
-			break;
-		case FINISH:
-			printf("%s\n", "FINISH");
-			break;
-		case ADD:
-			printf("%s\n", "ADD");
-			break;
-		case SUB:
-			printf("%s\n", "SUB");
-			break;
-		case MUL:
-			printf("%s\n", "MUL");
-			break;
-		case DIV:
-			printf("%s\n", "DIV");
-			break;
-		case AND:
-			printf("%s\n", "AND");
-			break;
-		case OR:
-			printf("%s\n", "OR");
-			break;
-		case NOT:
-			printf("%s\n", "NOT");
-			break;
-		case ASSIGN:
-			printf("%s\n", "ASSIGN");
-			break;
-		case EQUAL:
-			printf("%s\n", "EQUAL");
-			break;
-		case NOTEQ:
-			printf("%s\n", "NOTEQ");
-			break;
-		case LESS:
-			printf("%s\n", "LESS");
-			break;
-		case LESSEQ:
-			printf("%s\n", "LESSEQ");
-			break;
-		case GREATER:
-			printf("%s\n", "GREATER");
-			break;
-		case GREATERQ:
-			printf("%s\n", "GREATERQ");
+			printf("%s:%.5f\n", "REAL", tkReal(tks, i));
 			break;
 		default:
+			printf("%s\n", ATOMS_CODE_NAME[tkCode(tks, i)]);
 			break;
 		}
 	}
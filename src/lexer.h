@@ -1,113 +1,193 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "intern.h"
+
 // De adaugat in enum id cuvintelor cheie
 
+/**
+ * @brief all the atoms, declared once: X(code, spelling)
+ * @note the spelling is given only for delimiters and operators, which have a fixed spelling
+ * it is the input for the operators scanner, generated at build time by tools/opgen.c,
+ * so a new operator needs only a new entry here
+ */
+#define ATOMS(X)             \
+	X(ID, NULL)              \
+	/* keywords */           \
+	X(VAR, NULL)             \
+	X(FUNCTION, NULL)        \
+	X(IF, NULL)              \
+	X(ELSE, NULL)            \
+	X(WHILE, NULL)           \
+	X(END, NULL)             \
+	X(RETURN, NULL)          \
+	X(TYPE_INT, NULL)        \
+	X(TYPE_REAL, NULL)       \
+	X(TYPE_STR, NULL)        \
+	/* consts */             \
+	X(INT, NULL)             \
+	X(REAL, NULL)            \
+	X(STR, NULL)             \
+	/* delimiters */         \
+	X(COMMA, ",")            \
+	X(COLON, ":")            \
+	X(SEMICOLON, ";")        \
+	X(LPAR, "(")             \
+	X(RPAR, ")")             \
+	X(FINISH, NULL)          \
+	/* operators */          \
+	X(ADD, "+")              \
+	X(SUB, "-")              \
+	X(MUL, "*")              \
+	X(DIV, "/")              \
+	X(AND, "&&")             \
+	X(OR, "||")              \
+	X(NOT, "!")              \
+	X(ASSIGN, "=")           \
+	X(EQUAL, "==")           \
+	X(NOTEQ, "!=")           \
+	X(LESS, "<")             \
+	X(LESSEQ, "<=")          \
+	X(GREATER, ">")          \
+	X(GREATERQ, ">=")
+
+#define ATOM_CODE(code, spelling) code,
+#define ATOM_NAME(code, spelling) #code,
+#define ATOM_SPELLING(code, spelling) spelling,
+
 enum Atoms
 {
-	ID,
-
-	// keywords
-	VAR,
-	FUNCTION,
-	IF,
-	ELSE,
-	WHILE,
-	END,
-	RETURN,
-	TYPE_INT,
-	TYPE_REAL,
-	TYPE_STR,
-
-	// consts
-	INT,
-	REAL,
-	STR,
-
-	// delimiters
-	COMMA,
-	COLON,
-	SEMICOLON,
-	LPAR,
-	RPAR,
-	FINISH,
-
-	// operators
-	ADD,
-	SUB,
-	MUL,
-	DIV,
-	AND,
-	OR,
-	NOT,
-	ASSIGN,
-	EQUAL,
-	NOTEQ,
-	LESS,
-	LESSEQ,
-	GREATER,
-	GREATERQ
-	//
+	ATOMS(ATOM_CODE)
 };
 
 /**
  * @brief get atoms code name as a STRING by it's code
  */
 #define ATOMS_CODE_NAME \
-	(const char *[])     \
-	{                    \
-		"ID",             \
-			 "VAR",        \
-			 "FUNCTION",   \
-			 "IF",         \
-			 "ELSE",       \
-			 "WHILE",      \
-			 "END",        \
-			 "RETURN",     \
-			 "TYPE_INT",   \
-			 "TYPE_REAL",  \
-			 "TYPE_STR",   \
-			 "INT",        \
-			 "REAL",       \
-			 "STR",        \
-			 "COMMA",      \
-			 "COLON",      \
-			 "SEMICOLON",  \
-			 "LPAR",       \
-			 "RPAR",       \
-			 "FINISH",     \
-			 "ADD",        \
-			 "SUB",        \
-			 "MUL",        \
-			 "DIV",        \
-			 "AND",        \
-			 "OR",         \
-			 "NOT",        \
-			 "ASSIGN",     \
-			 "EQUAL",      \
-			 "NOTEQ",      \
-			 "LESS",       \
-			 "LESSEQ",     \
-			 "GREATER",    \
-			 "GREATERQ"    \
-	}
-
-#define MAX_STR 127
+	(const char *[]) { ATOMS(ATOM_NAME) }
 
-typedef struct
+/**
+ * @brief get the spelling of a delimiter or operator by it's code (ex: ADD -> "+")
+ */
+#define ATOMS_SPELLING \
+	(const char *[]) { ATOMS(ATOM_SPELLING) }
+
+/**
+ * @brief the keywords of the language and their codes
+ * @note this list is the input for the keywords recognizer which is generated at build time by tools/kwgen.c
+ */
+#define KEYWORDS(X)           \
+	X("var", VAR)             \
+	X("function", FUNCTION)   \
+	X("if", IF)               \
+	X("else", ELSE)           \
+	X("while", WHILE)         \
+	X("end", END)             \
+	X("return", RETURN)       \
+	X("int", TYPE_INT)        \
+	X("real", TYPE_REAL)      \
+	X("str", TYPE_STR)
+
+// the value of a token, kept apart from its code and line
+typedef union
 {
-	int code; // ID, TYPE_INT, ...
-	int line; // the line from the input file
-	union
+	int i;	  // the value for INT
+	double r; // the value for REAL
+	int id;	  // for ID, STR: the interned string, a span of chars in the source
+	struct
 	{
-		char text[MAX_STR + 1]; // the chars for ID, STR
-		int i;						// the value for INT
-		double r;					// the value for REAL
-	};
-} Token;
-
-#define MAX_TOKENS 4096
-extern Token tokens[];
-extern int nTokens;
-
-void tokenize(const char *pch);
-void showTokens();
+		unsigned offset; // the position of the chars in the source
+		unsigned len;
+	} span; // for ID, STR: used only while lexing in parallel, before the strings are interned
+} TokenVal;
+
+// The tokens list, stored as a struct of arrays: every field of a token has its own dense array,
+// all of them indexed by the token position. The chars of ID and STR are interned (see intern.h),
+// so repeated identifiers and string literals share the same storage.
+// The arrays grow as tokens are added, so there is no limit for the number of tokens.
+//
+// In the streaming mode (tokenizeLazy) the tokens are not produced ahead: they are lexed
+// only when the parser asks for them and only the last TK_RING tokens are kept, in a ring buffer.
+// This way the memory used by tokens does not depend on the input size.
+typedef struct
+{
+	unsigned char *code;	// ID, TYPE_INT, ...
+	int *line;				// the line from the input file
+	TokenVal *val;			// the value for INT, REAL, ID, STR
+	int n;					// nr of tokens
+	int cap;				// nr of tokens for which the arrays are allocated
+	int first;				// the first token still in memory, always 0 outside of the streaming mode
+	unsigned mask;			// the i-th token is at index (i & mask) in the arrays
+	bool stream;			// if the streaming mode is used
+	Interner *strings;		// the table where the chars of ID and STR are interned
+	struct Lexer *lexer;	// in the streaming mode, the lexer which adds the tokens
+} Tokens;
+
+// The size of the ring buffer used in the streaming mode. It must be a power of 2.
+// The parser can go back at most TK_RING - 1 tokens from the last token it has looked at.
+// sintaxer.c never goes back: it only looks at the current token and the error messages
+// look at most at the previous one (iTk - 1).
+#define TK_RING 8
+
+#define MAX_ERR 256 // the max length of an error message
+
+// the state of a lexer
+typedef struct Lexer
+{
+	const char *src; // the beginning of the input
+	const char *pch; // the current position in the input
+	const char *end; // if not NULL, the lexer stops at the first token which begins at or after end
+	const char *srcEnd; // in the streaming mode, the final \0 of the source: a \0 before it is an invalid char
+	int line;		 // the current line in the input
+	Tokens *tks;	 // the list where the tokens are added
+	bool spans;		 // if true, ID and STR are not interned and val.span keeps their position in src
+	jmp_buf *onErr;	 // if not NULL, an error is saved in errMsg and the lexer jumps here instead of exiting
+	char errMsg[MAX_ERR];
+	int errLine; // the line of the error, 0 if there was no error
+} Lexer;
+
+// lexes the tokens up to the i-th one in the streaming mode or reports that the i-th token
+// is not available anymore
+void fetchTk(Tokens *tks, int i);
+
+// returns the index in the tokens arrays for the i-th token
+static inline int tkIdx(Tokens *tks, int i)
+{
+	if (i >= tks->n || i < tks->first)
+		fetchTk(tks, i);
+	return (int)((unsigned)i & tks->mask);
+}
+
+// the code of the i-th token from the list tks
+#define tkCode(tks, idx) ((tks)->code[tkIdx((tks), (idx))])
+// the line of the i-th token
+#define tkLine(tks, idx) ((tks)->line[tkIdx((tks), (idx))])
+// the value of the i-th token, if it is an INT or a REAL
+#define tkInt(tks, idx) ((tks)->val[tkIdx((tks), (idx))].i)
+#define tkReal(tks, idx) ((tks)->val[tkIdx((tks), (idx))].r)
+// the interned string of the i-th token, if it is an ID or a STR
+#define tkId(tks, idx) ((tks)->val[tkIdx((tks), (idx))].id)
+
+// returns the chars of the i-th token if it is an ID or a STR, else its code name
+const char *tkText(Tokens *tks, int i);
+
+// prepares lx to add to tks the tokens from src, which must be ended with \0
+// the previous tokens from tks are removed, keeping the allocated memory
+// the chars of ID and STR are interned in strings, without being copied,
+// so the source must remain valid while the tokens are used
+void lexerInit(Lexer *lx, Tokens *tks, Interner *strings, const char *src);
+// tokenizes all the source
+void tokenize(Lexer *lx);
+// same as tokenize, but if the source is large, it is split in chunks at newlines and the chunks
+// are lexed in parallel on nThreads threads
+// size is the length of the source, without the final \0
+void tokenizeParallel(Lexer *lx, size_t size, int nThreads);
+// prepares the streaming mode: the tokens will be lexed only when they are accessed
+// size is the length of the source, without the final \0
+void tokenizeLazy(Lexer *lx, size_t size);
+// frees the memory of the tokens list
+void freeTokens(Tokens *tks);
+void showTokens(Tokens *tks);
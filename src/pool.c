@@ -0,0 +1,155 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "pool.h"
+#include "utils.h"
+
+typedef struct
+{
+	int n;
+	void (*fn)(int i, void *arg);
+	void *arg;
+	atomic_int next; // the next task to run
+} Tasks;
+
+int nCores()
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+}
+
+static void *worker(void *arg)
+{
+	Tasks *tasks = (Tasks *)arg;
+	for (int i; (i = atomic_fetch_add(&tasks->next, 1)) < tasks->n;)
+		tasks->fn(i, tasks->arg);
+	return NULL;
+}
+
+void runParallel(int n, void (*fn)(int i, void *arg), void *arg, int nThreads)
+{
+	Tasks tasks = {n, fn, arg, 0};
+	if (nThreads > n)
+		nThreads = n;
+	pthread_t threads[nThreads > 1 ? nThreads - 1 : 1];
+	int nStarted = 0;
+	for (; nStarted < nThreads - 1; nStarted++)
+	{
+		if (pthread_create(&threads[nStarted], NULL, worker, &tasks))
+			break; // the tasks are run by the threads which could be started
+	}
+	worker(&tasks);
+	for (int i = 0; i < nStarted; i++)
+		pthread_join(threads[i], NULL);
+}
+
+// ********************* work stealing *******************
+
+// the tasks [lo,hi) of a thread: the thread takes them from lo and the thieves from hi
+typedef struct
+{
+	_Alignas(64) pthread_mutex_t lock; // every range on its own cache line
+	int lo, hi;
+} Range;
+
+typedef struct
+{
+	void (*fn)(int i, void *arg);
+	void *arg;
+	int nThreads;
+	Range *ranges;
+} Stealing;
+
+typedef struct
+{
+	Stealing *st;
+	int id; // the index of the thread range
+} Thief;
+
+// takes the next task from the thread own range
+static bool takeTask(Range *r, int *i)
+{
+	pthread_mutex_lock(&r->lock);
+	bool found = r->lo < r->hi;
+	if (found)
+		*i = r->lo++;
+	pthread_mutex_unlock(&r->lock);
+	return found;
+}
+
+// moves to the empty range of the thread id half of the tasks of another thread
+// returns false if all the other ranges are empty
+static bool stealTasks(Stealing *st, int id)
+{
+	for (int k = 1; k < st->nThreads; k++)
+	{
+		Range *victim = &st->ranges[(id + k) % st->nThreads];
+		pthread_mutex_lock(&victim->lock);
+		int n = victim->hi - victim->lo;
+		int lo = victim->hi - (n + 1) / 2, hi = victim->hi;
+		victim->hi = lo;
+		pthread_mutex_unlock(&victim->lock);
+		if (n > 0)
+		{
+			// only one lock is held at a time, so there are no deadlocks
+			Range *own = &st->ranges[id];
+			pthread_mutex_lock(&own->lock);
+			own->lo = lo;
+			own->hi = hi;
+			pthread_mutex_unlock(&own->lock);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void *stealingWorker(void *arg)
+{
+	Thief *t = (Thief *)arg;
+	Stealing *st = t->st;
+	do
+	{
+		for (int i; takeTask(&st->ranges[t->id], &i);)
+			st->fn(i, st->arg);
+	} while (stealTasks(st, t->id));
+	return NULL;
+}
+
+void runStealing(int n, void (*fn)(int i, void *arg), void *arg, int nThreads)
+{
+	if (nThreads > n)
+		nThreads = n;
+	if (nThreads < 1)
+		nThreads = 1;
+	Range *ranges = (Range *)aligned_alloc(_Alignof(Range), nThreads * sizeof(Range));
+	Thief *thieves = (Thief *)safeAlloc(nThreads * sizeof(Thief));
+	if (!ranges)
+		err("not enough memory");
+	Stealing st = {fn, arg, nThreads, ranges};
+	for (int i = 0; i < nThreads; i++)
+	{
+		pthread_mutex_init(&ranges[i].lock, NULL);
+		ranges[i].lo = (int)((long long)n * i / nThreads);
+		ranges[i].hi = (int)((long long)n * (i + 1) / nThreads);
+		thieves[i] = (Thief){&st, i};
+	}
+
+	pthread_t threads[nThreads > 1 ? nThreads - 1 : 1];
+	int nStarted = 0;
+	for (; nStarted < nThreads - 1; nStarted++)
+	{
+		if (pthread_create(&threads[nStarted], NULL, stealingWorker, &thieves[nStarted + 1]))
+			break; // the ranges of the threads which were not started are stolen by the others
+	}
+	stealingWorker(&thieves[0]);
+	for (int i = 0; i < nStarted; i++)
+		pthread_join(threads[i], NULL);
+
+	for (int i = 0; i < nThreads; i++)
+		pthread_mutex_destroy(&ranges[i].lock);
+	free(ranges);
+	free(thieves);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// returns the number of cores available for this process
+int nCores();
+
+// runs fn(i, arg) for every i in [0,n) on nThreads threads (the calling thread is one of them)
+// and returns after all of them are done
+// the tasks are taken in order by the first free thread, so they can have different durations
+void runParallel(int n, void (*fn)(int i, void *arg), void *arg, int nThreads);
+
+// same as runParallel, but every thread begins with its own contiguous range of tasks and,
+// when it has no more tasks, it steals half of the remaining tasks of another thread
+// use it when there are many tasks with very different durations (ex: files of different sizes)
+void runStealing(int n, void (*fn)(int i, void *arg), void *arg, int nThreads);
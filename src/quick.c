@@ -1,16 +1,242 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
 
 #include "utils.h"
-#include "lexer.h"
-#include "sintaxer.h"
-
-int main() {
-    char *buff = loadFile("q-src/1.q");
-    tokenize(buff);
-    showTokens();
-    
-    parse();
-
-    return 0;
-}
\ No newline at end of file
+#include "compiler.h"
+#include "scan.h"
+#include "pool.h"
+#include "trace.h"
+#include "server.h"
+#include "cache.h"
+#include "fnstate.h"
+
+// usage: build [options] [file.q ...]
+// every file.q is transpiled in file.c, next to it; the files are transpiled in parallel
+// without input files, q-src/1.q is transpiled in gen-code/1.c
+// options:
+//   --stream       the tokens are lexed only when the parser needs them, in a bounded buffer,
+//                  so the memory used by tokens does not depend on the input size
+//   -j N           the number of threads (default: the number of cores); with one input file,
+//                  large inputs are lexed in parallel on them, else the files are shared among them
+//   --manifest F   the input files are also read from F, one per line (the empty lines and
+//                  the lines which begin with # are skipped)
+//   --parallel-fns the function bodies are compiled in parallel (with one input file, on -j threads);
+//                  the output is the same as without it
+//   --serve S      runs as a server on the Unix socket S, with a few compilers reused by
+//                  the requests (see server.h); the input files are ignored
+//   --connect S    the files are transpiled by the server from the Unix socket S
+//   --cache D      the generated code is cached in the directory D (see cache.h); the files
+//                  whose source, options and transpiler are unchanged are not compiled again
+//   --cache-size M the size limit of the cache, in MB (default: 256)
+//   --incremental  the code of every function is kept in file.c.state and, at the next build,
+//                  only the changed functions are compiled again (see fnstate.h); ignored with --stream
+//   --out-budget M the memory kept for the generated code of a file, in MB (default: 64); over it,
+//                  the code is moved to temp files until the end (0: all the code is kept in memory)
+//   --log          shows the info messages of the compiler
+//   --trace N      traces the parser (1: rules, 2: also the tokens) and shows the trace at the end;
+//                  with 2 the tokens list is also shown
+
+// a file to transpile
+typedef struct {
+    const char *inName;
+    char *outName;
+    bool ok;
+    char errMsg[MAX_ERR + 64]; // the error, if !ok
+} Job;
+
+typedef struct {
+    Job *jobs;
+    int n, cap;
+    bool stream;
+    bool parallelFns;
+    bool incremental;
+    uint64_t exeHash[2]; // with incremental or cache, the hash of the transpiler, for the fingerprints and the keys of all the files
+    const char *server; // if not NULL, the socket of the server which transpiles the files
+    Cache *cache;       // if not NULL, the cache of the generated code
+    int nThreads; // for the parallel lexing and functions compilation of every file
+    size_t outBudget; // Compiler.outBudget for every file
+} Batch;
+
+// returns the name of the output file for an input file: the extension .q is replaced with .c
+char *outNameFor(const char *inName) {
+    size_t len = strlen(inName);
+    if (len > 2 && !strcmp(inName + len - 2, ".q"))
+        len -= 2;
+    char *outName = (char *)safeAlloc(len + 3);
+    memcpy(outName, inName, len);
+    strcpy(outName + len, ".c");
+    return outName;
+}
+
+void addJob(Batch *b, const char *inName, char *outName) {
+    if (b->n == b->cap) {
+        b->cap = b->cap ? b->cap * 2 : 16;
+        Job *p = (Job *)realloc(b->jobs, b->cap * sizeof(Job));
+        if (!p)
+            err("not enough memory");
+        b->jobs = p;
+    }
+    b->jobs[b->n++] = (Job){.inName = inName, .outName = outName};
+}
+
+// adds a job for every file listed in a manifest
+void readManifest(Batch *b, const char *fileName) {
+    char *text = loadFile(fileName); // never freed, the names point into it
+    for (char *line = strtok(text, "\r\n"); line; line = strtok(NULL, "\r\n")) {
+        if (*line && *line != '#')
+            addJob(b, line, outNameFor(line));
+    }
+}
+
+void compileJob(int i, void *arg) {
+    Batch *b = (Batch *)arg;
+    Job *job = &b->jobs[i];
+    if (b->server) {
+        job->ok = transpileRemote(b->server, job->inName, job->outName, job->errMsg, sizeof(job->errMsg));
+        return;
+    }
+    size_t size;
+    const char *src = tryMapFile(job->inName, &size);
+    if (!src) {
+        snprintf(job->errMsg, sizeof(job->errMsg), "unable to open: %s", strerror(errno));
+        return;
+    }
+    char key[CACHE_KEY_LEN + 1];
+    if (b->cache) {
+        cacheKey(b->cache, src, size, b->stream | b->parallelFns << 1 | b->incremental << 2, key);
+        if (cacheGet(b->cache, key, job->outName)) {
+            job->ok = true;
+            unmapFile(src, size);
+            return;
+        }
+    }
+
+    Compiler c;
+    compilerInit(&c);
+    c.stream = b->stream;
+    c.nThreads = b->nThreads;
+    c.parallelFns = b->parallelFns;
+    c.outBudget = b->outBudget;
+    FnState prevFns;
+    char *stateName = NULL;
+    if (b->incremental) {
+        size_t len = strlen(job->outName) + sizeof(".state");
+        stateName = (char *)safeAlloc(len);
+        snprintf(stateName, len, "%s.state", job->outName);
+        fnStateLoad(&prevFns, stateName, b->exeHash);
+        c.prevFns = &prevFns;
+    }
+    if (!compile(&c, src, size))
+        snprintf(job->errMsg, sizeof(job->errMsg), "error in line %d: %s", c.errLine, c.errMsg);
+    else if (!writeCode(&c, job->outName))
+        snprintf(job->errMsg, sizeof(job->errMsg), "cannot write to file '%s'", job->outName);
+    else
+        job->ok = true;
+    if (job->ok && b->cache)
+        cachePut(b->cache, key, &c);
+    // a failed save only makes the next build compile all the functions
+    if (job->ok && stateName && c.splitFns)
+        fnStateSave(&c, stateName);
+    if (traceLevel) {
+        flockfile(stdout); // the trace of a file is not mixed with the others
+        if (b->n > 1)
+            printf("trace of %s:\n", job->inName);
+        traceDump(stdout);
+        funlockfile(stdout);
+    }
+    compilerFree(&c);
+    if (stateName) {
+        fnStateFree(&prevFns);
+        free(stateName);
+    }
+    unmapFile(src, size);
+}
+
+int main(int argc, char *argv[]) {
+    Batch b = {0};
+    int nThreads = nCores();
+    const char *serverSocket = NULL;
+    const char *cacheDir = NULL;
+    unsigned long long cacheSize = 256;
+    b.outBudget = OUT_BUDGET;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--stream"))
+            b.stream = true;
+        else if (!strcmp(argv[i], "--parallel-fns"))
+            b.parallelFns = true;
+        else if (!strcmp(argv[i], "--incremental"))
+            b.incremental = true;
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+            nThreads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--log"))
+            logInfo = true;
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+            traceLevel = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--serve") && i + 1 < argc)
+            serverSocket = argv[++i];
+        else if (!strcmp(argv[i], "--connect") && i + 1 < argc)
+            b.server = argv[++i];
+        else if (!strcmp(argv[i], "--cache") && i + 1 < argc)
+            cacheDir = argv[++i];
+        else if (!strcmp(argv[i], "--cache-size") && i + 1 < argc)
+            cacheSize = strtoull(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--out-budget") && i + 1 < argc)
+            b.outBudget = (size_t)strtoull(argv[++i], NULL, 10) << 20;
+        else if (!strcmp(argv[i], "--manifest") && i + 1 < argc)
+            readManifest(&b, argv[++i]);
+        else if (argv[i][0] == '-')
+            err("unknown option: %s", argv[i]);
+        else
+            addJob(&b, argv[i], outNameFor(argv[i]));
+    }
+    if (b.n == 0)
+        addJob(&b, "q-src/1.q", strcpy((char *)safeAlloc(sizeof("gen-code/1.c")), "gen-code/1.c"));
+    if (nThreads < 1)
+        nThreads = 1;
+
+    scanInit();
+    if (serverSocket) {
+        serve(serverSocket, nThreads);
+        err("cannot serve on %s: %s", serverSocket, strerror(errno));
+    }
+    // reading the whole executable is slow, so it is hashed once for the fingerprints and the cache
+    if (b.incremental || cacheDir) {
+        hashInit(b.exeHash);
+        hashExe(b.exeHash);
+    }
+    Cache cache;
+    if (cacheDir) {
+        if (!cacheOpen(&cache, cacheDir, cacheSize * 1024 * 1024, b.exeHash))
+            err("cannot use the cache %s: %s", cacheDir, strerror(errno));
+        b.cache = &cache;
+    }
+    if (b.n == 1) {
+        // a single file can use all the threads for the parallel lexing
+        b.nThreads = nThreads;
+        compileJob(0, &b);
+    } else {
+        // the files are already compiled in parallel, so every file is lexed on one thread
+        b.nThreads = 1;
+        runStealing(b.n, compileJob, &b, nThreads);
+    }
+
+    // the errors are shown in the order of the files, whatever the order of compilation
+    int nFailed = 0;
+    for (int i = 0; i < b.n; i++) {
+        Job *job = &b.jobs[i];
+        if (!job->ok) {
+            if (b.n > 1)
+                fprintf(stderr, "%s: ", job->inName);
+            fprintf(stderr, "%s\n", job->errMsg);
+            nFailed++;
+        }
+        free(job->outName);
+    }
+    free(b.jobs);
+    if (b.cache)
+        cacheClose(b.cache);
+    return nFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
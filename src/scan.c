@@ -0,0 +1,234 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86
+#endif
+
+// ********************* scalar *******************
+
+static const char *scalarSpaces(const char *p, int *line)
+{
+	for (;; p++)
+	{
+		if (*p == '\n')
+			(*line)++;
+		else if (*p != ' ' && *p != '\t')
+			return p;
+	}
+}
+
+static const char *scalarLineEnd(const char *p)
+{
+	while (*p != '\n' && *p != '\r' && *p != '\0')
+		p++;
+	return p;
+}
+
+static const char *scalarIdent(const char *p)
+{
+	for (;; p++)
+	{
+		unsigned char ch = (unsigned char)*p;
+		if (!((unsigned char)((ch | 0x20) - 'a') <= 'z' - 'a' || (unsigned char)(ch - '0') <= 9 || ch == '_'))
+			return p;
+	}
+}
+
+static const Scanner scalarScanner = {"scalar", scalarSpaces, scalarLineEnd, scalarIdent};
+
+#ifdef SCAN_X86
+
+// The SIMD kernels load only aligned blocks. An aligned block never crosses a page boundary,
+// so reading the whole block which contains the final '\0' is safe.
+// The bits for the chars before p in the first block are masked out.
+// The bytes of a block after the '\0' can be outside the buffer, so ASan is disabled for the kernels.
+#define NO_ASAN __attribute__((no_sanitize_address))
+
+// ********************* SSE2 *******************
+
+// 0xFF for the bytes of x in [lo,hi]
+static inline __m128i sse2InRange(__m128i x, char lo, char hi)
+{
+	__m128i d = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+	return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8((char)(hi - lo))), d);
+}
+
+static inline unsigned sse2IdentMask(__m128i x)
+{
+	__m128i alpha = sse2InRange(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+	__m128i digit = sse2InRange(x, '0', '9');
+	__m128i under = _mm_cmpeq_epi8(x, _mm_set1_epi8('_'));
+	return (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under));
+}
+
+NO_ASAN static const char *sse2Spaces(const char *p, int *line)
+{
+	const char *block = (const char *)((uintptr_t)p & ~(uintptr_t)15);
+	unsigned valid = (0xFFFFu << (p - block)) & 0xFFFFu;
+	for (;;)
+	{
+		__m128i x = _mm_load_si128((const __m128i *)block);
+		unsigned nl = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n'))) & valid;
+		unsigned blank = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'))));
+		unsigned stop = ~(blank | nl) & valid;
+		if (stop)
+		{
+			unsigned end = (unsigned)__builtin_ctz(stop);
+			*line += __builtin_popcount(nl & ((1u << end) - 1));
+			return block + end;
+		}
+		*line += __builtin_popcount(nl);
+		block += 16;
+		valid = 0xFFFFu;
+	}
+}
+
+NO_ASAN static const char *sse2LineEnd(const char *p)
+{
+	const char *block = (const char *)((uintptr_t)p & ~(uintptr_t)15);
+	unsigned valid = (0xFFFFu << (p - block)) & 0xFFFFu;
+	for (;;)
+	{
+		__m128i x = _mm_load_si128((const __m128i *)block);
+		__m128i end = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\r'))),
+											_mm_cmpeq_epi8(x, _mm_setzero_si128()));
+		unsigned stop = (unsigned)_mm_movemask_epi8(end) & valid;
+		if (stop)
+			return block + __builtin_ctz(stop);
+		block += 16;
+		valid = 0xFFFFu;
+	}
+}
+
+NO_ASAN static const char *sse2Ident(const char *p)
+{
+	const char *block = (const char *)((uintptr_t)p & ~(uintptr_t)15);
+	unsigned valid = (0xFFFFu << (p - block)) & 0xFFFFu;
+	for (;;)
+	{
+		__m128i x = _mm_load_si128((const __m128i *)block);
+		unsigned stop = ~sse2IdentMask(x) & valid;
+		if (stop)
+			return block + __builtin_ctz(stop);
+		block += 16;
+		valid = 0xFFFFu;
+	}
+}
+
+static const Scanner sse2Scanner = {"sse2", sse2Spaces, sse2LineEnd, sse2Ident};
+
+// ********************* AVX2 *******************
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i avx2InRange(__m256i x, char lo, char hi)
+{
+	__m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+	return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8((char)(hi - lo))), d);
+}
+
+AVX2 static inline unsigned avx2IdentMask(__m256i x)
+{
+	__m256i alpha = avx2InRange(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z');
+	__m256i digit = avx2InRange(x, '0', '9');
+	__m256i under = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_'));
+	return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), under));
+}
+
+AVX2 NO_ASAN static const char *avx2Spaces(const char *p, int *line)
+{
+	const char *block = (const char *)((uintptr_t)p & ~(uintptr_t)31);
+	unsigned valid = 0xFFFFFFFFu << (p - block);
+	for (;;)
+	{
+		__m256i x = _mm256_load_si256((const __m256i *)block);
+		unsigned nl = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n'))) & valid;
+		unsigned blank = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t'))));
+		unsigned stop = ~(blank | nl) & valid;
+		if (stop)
+		{
+			unsigned end = (unsigned)__builtin_ctz(stop);
+			*line += __builtin_popcount(nl & ((1u << end) - 1));
+			return block + end;
+		}
+		*line += __builtin_popcount(nl);
+		block += 32;
+		valid = 0xFFFFFFFFu;
+	}
+}
+
+AVX2 NO_ASAN static const char *avx2LineEnd(const char *p)
+{
+	const char *block = (const char *)((uintptr_t)p & ~(uintptr_t)31);
+	unsigned valid = 0xFFFFFFFFu << (p - block);
+	for (;;)
+	{
+		__m256i x = _mm256_load_si256((const __m256i *)block);
+		__m256i end = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r'))),
+												_mm256_cmpeq_epi8(x, _mm256_setzero_si256()));
+		unsigned stop = (unsigned)_mm256_movemask_epi8(end) & valid;
+		if (stop)
+			return block + __builtin_ctz(stop);
+		block += 32;
+		valid = 0xFFFFFFFFu;
+	}
+}
+
+AVX2 NO_ASAN static const char *avx2Ident(const char *p)
+{
+	const char *block = (const char *)((uintptr_t)p & ~(uintptr_t)31);
+	unsigned valid = 0xFFFFFFFFu << (p - block);
+	for (;;)
+	{
+		__m256i x = _mm256_load_si256((const __m256i *)block);
+		unsigned stop = ~avx2IdentMask(x) & valid;
+		if (stop)
+			return block + __builtin_ctz(stop);
+		block += 32;
+		valid = 0xFFFFFFFFu;
+	}
+}
+
+static const Scanner avx2Scanner = {"avx2", avx2Spaces, avx2LineEnd, avx2Ident};
+
+#endif
+
+const Scanner *scanner = &scalarScanner;
+
+bool scanUse(const char *name)
+{
+	if (!strcmp(name, "scalar"))
+	{
+		scanner = &scalarScanner;
+		return true;
+	}
+#ifdef SCAN_X86
+	__builtin_cpu_init();
+	if (!strcmp(name, "sse2") && __builtin_cpu_supports("sse2"))
+	{
+		scanner = &sse2Scanner;
+		return true;
+	}
+	if (!strcmp(name, "avx2") && __builtin_cpu_supports("avx2"))
+	{
+		scanner = &avx2Scanner;
+		return true;
+	}
+#endif
+	return false;
+}
+
+void scanInit()
+{
+	const char *forced = getenv("QUICK_SCAN");
+	if (forced && scanUse(forced))
+		return;
+	if (scanUse("avx2") || scanUse("sse2"))
+		return;
+	scanUse("scalar");
+}
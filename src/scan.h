@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Kernels used by tokenize to skip runs of chars of the same class.
+// All of them stop at '\0', so the input must be ended with '\0'.
+// The SIMD versions read whole aligned blocks, so they can read up to 31 bytes after the '\0'.
+// This is safe even at the end of a buffer: an aligned block is inside a single page, the page
+// of the '\0', so it never touches an unmapped page. The chars read after the '\0' are ignored.
+// Such reads are reported by ASan, so they are excluded from its checks.
+// The SIMD versions classify 16 (SSE2) or 32 (AVX2) chars at once and the best version
+// supported by the CPU is chosen at runtime, with a scalar fallback.
+typedef struct
+{
+	const char *name; // "scalar", "sse2", "avx2"
+
+	// skips ' ', '\t' and '\n', adding to *line the number of skipped '\n'
+	const char *(*spaces)(const char *p, int *line);
+	// returns the first '\n', '\r' or '\0' (the end of a comment)
+	const char *(*lineEnd)(const char *p);
+	// skips [a-zA-Z0-9_]
+	const char *(*ident)(const char *p);
+} Scanner;
+
+// the kernels used by tokenize
+extern const Scanner *scanner;
+
+// selects the best kernels for this CPU
+// the environment variable QUICK_SCAN=scalar|sse2|avx2 can force a version
+void scanInit();
+
+// selects the kernels by name
+// returns false if they are not available on this CPU
+bool scanUse(const char *name);
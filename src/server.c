@@ -0,0 +1,294 @@
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "compiler.h"
+#include "pool.h"
+#include "utils.h"
+
+// the max length of a header line, with its \n
+#define MAX_HEADER 64
+// the max size of a request body
+#define MAX_BODY ((size_t)1 << 30)
+// the number of workers, every one with its own compiler, so a slow client delays only its worker
+#define SERVER_WORKERS 4
+// the seconds a connection can wait for a read or a write before it is dropped
+#define SERVER_TIMEOUT 10
+// the milliseconds a worker waits after accept failed for lack of resources (ex: EMFILE)
+#define ACCEPT_BACKOFF_MS 100
+
+typedef struct
+{
+	int sock; // the listening socket
+	int nThreads;
+} Server;
+
+static bool readAll(int fd, char *buf, size_t n)
+{
+	while (n)
+	{
+		ssize_t k = read(fd, buf, n);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k <= 0)
+			return false;
+		buf += k;
+		n -= k;
+	}
+	return true;
+}
+
+// reads a header line "<kind> <len>\n"; kind must have at least 16 chars
+static bool readHeader(int fd, char *kind, size_t *len)
+{
+	char line[MAX_HEADER];
+	size_t n = 0;
+	for (;;)
+	{
+		if (n == sizeof(line) - 1 || !readAll(fd, line + n, 1))
+			return false;
+		if (line[n] == '\n')
+			break;
+		n++;
+	}
+	line[n] = '\0';
+	return sscanf(line, "%15s %zu", kind, len) == 2;
+}
+
+static bool writeHeader(int fd, const char *kind, size_t len)
+{
+	char line[MAX_HEADER];
+	int n = snprintf(line, sizeof(line), "%s %zu\n", kind, len);
+	return writeAll(fd, line, n);
+}
+
+static void sendError(int fd, const char *msg)
+{
+	if (writeHeader(fd, "error", strlen(msg)))
+		writeAll(fd, msg, strlen(msg));
+}
+
+// sends the generated code, after its size
+static void sendCode(int fd, Compiler *c)
+{
+	if (writeHeader(fd, "ok", codeSize(c)))
+		writeCodeTo(c, fd);
+}
+
+// reads a request from a connection, compiles it and sends the response
+static void serveRequest(Compiler *c, int fd)
+{
+	char kind[16];
+	size_t len;
+	if (!readHeader(fd, kind, &len) || len > MAX_BODY)
+	{
+		sendError(fd, "bad request");
+		return;
+	}
+	// the size comes from the client, so a failed allocation is only an error for its request
+	char *body = (char *)malloc(len + 1);
+	if (!body)
+	{
+		sendError(fd, "not enough memory");
+		return;
+	}
+	if (!readAll(fd, body, len))
+	{
+		free(body);
+		return;
+	}
+	body[len] = '\0';
+
+	char errMsg[MAX_ERR + PATH_MAX];
+	const char *src = NULL;
+	size_t size = 0;
+	bool mapped = false;
+	if (!strcmp(kind, "source"))
+	{
+		src = body;
+		size = len;
+	}
+	else if (!strcmp(kind, "path"))
+	{
+		src = tryMapFile(body, &size);
+		mapped = src != NULL;
+		if (!src)
+			snprintf(errMsg, sizeof(errMsg), "unable to open %s: %s", body, strerror(errno));
+	}
+	else
+	{
+		snprintf(errMsg, sizeof(errMsg), "unknown request: %s", kind);
+	}
+
+	if (src)
+	{
+		if (compile(c, src, size))
+		{
+			sendCode(fd, c);
+		}
+		else
+		{
+			snprintf(errMsg, sizeof(errMsg), "error in line %d: %s", c->errLine, c->errMsg);
+			sendError(fd, errMsg);
+		}
+		compilerReset(c); // before the source is released, because the interned spans point into it
+	}
+	else
+	{
+		sendError(fd, errMsg);
+	}
+	if (mapped)
+		unmapFile(src, size);
+	free(body);
+}
+
+// accepts the connections and serves them one by one, with its own compiler
+static void serveWorker(int i, void *arg)
+{
+	(void)i;
+	Server *server = (Server *)arg;
+	Compiler c;
+	compilerInit(&c);
+	c.nThreads = server->nThreads;
+	struct timeval timeout = {.tv_sec = SERVER_TIMEOUT};
+	struct timespec backoff = {.tv_nsec = ACCEPT_BACKOFF_MS * 1000000L};
+	for (;;)
+	{
+		int fd = accept(server->sock, NULL, NULL);
+		if (fd < 0)
+		{
+			// the other errors last until some resources are released, so retrying at once would only spin
+			if (errno != EINTR && errno != ECONNABORTED)
+			{
+				ELOG("accept failed: %s\n", strerror(errno));
+				nanosleep(&backoff, NULL);
+			}
+			continue;
+		}
+		// a client which sends or reads nothing makes readAll or writeAll fail, so its connection is closed
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		serveRequest(&c, fd);
+		close(fd);
+	}
+}
+
+static int connectTo(const char *socketPath)
+{
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	if (strlen(socketPath) >= sizeof(addr.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(addr.sun_path, socketPath);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		int e = errno;
+		close(fd);
+		errno = e;
+		return -1;
+	}
+	return fd;
+}
+
+bool serve(const char *socketPath, int nThreads)
+{
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	if (strlen(socketPath) >= sizeof(addr.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		return false;
+	}
+	strcpy(addr.sun_path, socketPath);
+	// a socket left by a previous server is replaced, but a running server keeps its socket
+	struct stat st;
+	if (!stat(socketPath, &st) && S_ISSOCK(st.st_mode))
+	{
+		int fd = connectTo(socketPath);
+		if (fd >= 0)
+		{
+			close(fd);
+			errno = EADDRINUSE;
+			return false;
+		}
+		if (errno == ECONNREFUSED)
+			unlink(socketPath);
+	}
+	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0)
+		return false;
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(sock, SOMAXCONN) < 0)
+	{
+		int e = errno;
+		close(sock);
+		errno = e;
+		return false;
+	}
+	signal(SIGPIPE, SIG_IGN); // a client which closes its connection early must not stop the server
+
+	// the workers never end
+	Server server = {sock, nThreads};
+	runParallel(SERVER_WORKERS, serveWorker, &server, SERVER_WORKERS);
+	return true;
+}
+
+bool transpileRemote(const char *socketPath, const char *inName, const char *outName, char *errMsg, size_t errSize)
+{
+	// the server can have another current directory
+	char path[PATH_MAX];
+	if (!realpath(inName, path))
+	{
+		snprintf(errMsg, errSize, "unable to open: %s", strerror(errno));
+		return false;
+	}
+	int fd = connectTo(socketPath);
+	if (fd < 0)
+	{
+		snprintf(errMsg, errSize, "cannot connect to the server %s: %s", socketPath, strerror(errno));
+		return false;
+	}
+	char kind[16];
+	size_t len;
+	char *body = NULL;
+	bool ok = writeHeader(fd, "path", strlen(path)) && writeAll(fd, path, strlen(path)) &&
+			  readHeader(fd, kind, &len) && len <= MAX_BODY;
+	if (ok)
+	{
+		body = (char *)safeAlloc(len + 1);
+		ok = readAll(fd, body, len);
+		body[len] = '\0';
+	}
+	close(fd);
+	if (!ok)
+	{
+		snprintf(errMsg, errSize, "the server %s did not answer", socketPath);
+	}
+	else if (strcmp(kind, "ok"))
+	{
+		snprintf(errMsg, errSize, "%s", body);
+		ok = false;
+	}
+	else
+	{
+		FILE *fis = fopen(outName, "w");
+		ok = fis && fwrite(body, 1, len, fis) == len;
+		if (fis && fclose(fis))
+			ok = false;
+		if (!ok)
+			snprintf(errMsg, errSize, "cannot write to file '%s'", outName);
+	}
+	free(body);
+	return ok;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// The transpiler as a server on a Unix domain socket, so the clients do not pay for
+// the process startup and for the initialization of the compiler at every file.
+// The server has a few workers, which accept the connections and serve them at the same time.
+// Every worker keeps its own compiler, reused by all its requests (see compilerReset).
+// A connection idle for longer than a timeout is closed, so it cannot block its worker forever.
+//
+// Every connection carries one request and its response, both made of a header line
+// followed by a body of the given number of bytes:
+//   request:  "path <len>\n" and the path of a Quick file, as seen by the server
+//             "source <len>\n" and the Quick source
+//   response: "ok <len>\n" and the generated C code
+//             "error <len>\n" and the error message
+
+// runs the server on the socket from socketPath
+// nThreads is the number of threads for the parallel lexing of every source
+// it returns only if the socket cannot be created, with false and the cause in errno
+// (EADDRINUSE if another server is running on socketPath)
+bool serve(const char *socketPath, int nThreads);
+
+// transpiles the file inName with the server from socketPath and writes the C code in outName
+// on error returns false, with the message in errMsg
+bool transpileRemote(const char *socketPath, const char *inName, const char *outName, char *errMsg, size_t errSize);
@@ -0,0 +1,117 @@
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "sink.h"
+#include "utils.h"
+
+// the size of the buffer used to copy a spill file
+#define COPY_BUF (64 * 1024)
+
+bool spillText(Spill *spill, Text *text)
+{
+	if (!text->n)
+		return true;
+	if (!spill->file && !(spill->file = tmpfile()))
+		return false;
+	if (fwrite(text->buf, 1, text->n, spill->file) != text->n)
+		return false;
+	spill->n += text->n;
+	Text_reset(text);
+	return true;
+}
+
+bool spillCopy(Spill *spill, size_t pos, size_t len, FILE *out)
+{
+	if (fflush(spill->file))
+		return false;
+	char buf[COPY_BUF];
+	int fd = fileno(spill->file);
+	for (size_t end = pos + len; pos < end;)
+	{
+		size_t n = end - pos < sizeof(buf) ? end - pos : sizeof(buf);
+		ssize_t k = pread(fd, buf, n, (off_t)pos);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k <= 0 || fwrite(buf, 1, k, out) != (size_t)k)
+			return false;
+		pos += k;
+	}
+	return true;
+}
+
+void spillFree(Spill *spill)
+{
+	if (spill->file)
+		fclose(spill->file);
+	*spill = (Spill){0};
+}
+
+void sinkInit(Sink *sink, int fd)
+{
+	sink->fd = fd;
+	sink->nIov = 0;
+	sink->ok = true;
+}
+
+void sinkChars(Sink *sink, const char *chars, size_t n)
+{
+	if (!n)
+		return;
+	if (sink->nIov == SINK_IOV)
+		sinkFlush(sink);
+	sink->iov[sink->nIov++] = (struct iovec){(void *)chars, n};
+}
+
+void sinkSpill(Sink *sink, Spill *spill)
+{
+	if (!spill->n)
+		return;
+	sinkFlush(sink);
+	if (!sink->ok || fflush(spill->file))
+	{
+		sink->ok = false;
+		return;
+	}
+	char buf[COPY_BUF];
+	int fd = fileno(spill->file);
+	for (off_t pos = 0; pos < (off_t)spill->n;)
+	{
+		ssize_t k = pread(fd, buf, sizeof(buf), pos);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k <= 0 || !writeAll(sink->fd, buf, k))
+		{
+			sink->ok = false;
+			return;
+		}
+		pos += k;
+	}
+}
+
+bool sinkFlush(Sink *sink)
+{
+	struct iovec *iov = sink->iov;
+	int n = sink->nIov;
+	sink->nIov = 0;
+	while (n && sink->ok)
+	{
+		ssize_t k = writev(sink->fd, iov, n);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k <= 0)
+		{
+			sink->ok = false;
+			break;
+		}
+		// after a partial write, the written segments are skipped and the rest of the last one is kept
+		for (; n && (size_t)k >= iov->iov_len; iov++, n--)
+			k -= iov->iov_len;
+		if (n)
+		{
+			iov->iov_base = (char *)iov->iov_base + k;
+			iov->iov_len -= k;
+		}
+	}
+	return sink->ok;
+}
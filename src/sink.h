@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/uio.h>
+
+#include "gen.h"
+
+// The output of the generated code.
+// The code is written as a list of segments, without concatenating them in memory:
+// the segments from memory are gathered and written with writev, and the spilled
+// segments are copied from their temp files.
+// A section of the code which grows over the memory budget of the compiler is spilled:
+// its chars are moved to the end of a temp file and its buffer is reused for the next ones.
+
+#define SINK_IOV 64 // the max memory segments written by one writev
+
+// the older chars of a section, moved from its buffer to a temp file
+typedef struct
+{
+	FILE *file; // the temp file, NULL until the first spill; it is deleted when closed
+	size_t n;	// the chars from it
+} Spill;
+
+// moves all the chars of text to the end of the spill, so the text is empty after it
+// returns false on error, with the cause in errno
+bool spillText(Spill *spill, Text *text);
+
+// writes in out len chars of the spill, from pos
+// returns false on error
+bool spillCopy(Spill *spill, size_t pos, size_t len, FILE *out);
+
+// deletes the temp file of a spill
+void spillFree(Spill *spill);
+
+typedef struct
+{
+	int fd;					  // the destination
+	struct iovec iov[SINK_IOV]; // the memory segments not written yet
+	int nIov;
+	bool ok; // false after a write error
+} Sink;
+
+// begins to write in the file descriptor fd
+void sinkInit(Sink *sink, int fd);
+
+// adds a segment from memory; the chars must remain valid until sinkFlush
+void sinkChars(Sink *sink, const char *chars, size_t n);
+
+// adds all the chars of a spill, after the segments added before it
+void sinkSpill(Sink *sink, Spill *spill);
+
+// writes all the segments not written yet
+// returns false if any write failed
+bool sinkFlush(Sink *sink);
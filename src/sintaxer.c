@@ -12,51 +12,59 @@
 #include <stdarg.h>
 #include <string.h>
 
-#include "lexer.h"
-#include "ad.h"
+#include "compiler.h"
+#include "sintaxer.h"
 #include "utils.h"
 #include "at.h"
-#include "gen.h"
+#include "trace.h"
 
 /** short version of @code unsigned short int @endcode */
 #define USINT unsigned short int;
 
-int iTk = 0;	  // the iterator in tokens
-Token *consumed; // the last consumed token
+/** @brief the bit for a token code in a set of tokens */
+#define TK_SET(code) (1ull << (code))
+_Static_assert(GREATERQ < 64, "the token sets must fit in 64 bits");
+
+/*
+ * FIRST sets of the rules: every rule is chosen only by the current token,
+ * so the parser never goes back and every token is examined once.
+ */
+#define FIRST_FACTOR (TK_SET(INT) | TK_SET(REAL) | TK_SET(STR) | TK_SET(LPAR) | TK_SET(ID))
+#define FIRST_EXPR (FIRST_FACTOR | TK_SET(SUB) | TK_SET(NOT))
+#define FIRST_INSTR (FIRST_EXPR | TK_SET(SEMICOLON) | TK_SET(IF) | TK_SET(RETURN) | TK_SET(WHILE))
+
+/** @brief trace points for the beginning and the end of a rule (see trace.h) */
+#define TRACE_ENTER() TRACE(TRACE_RULES, TR_ENTER, __func__, tkLine(&c->tokens, c->iTk), 0, 0)
+#define TRACE_EXIT() TRACE(TRACE_RULES, TR_EXIT, __func__, tkLine(&c->tokens, c->iTk), 0, 0)
 
 /* Declaration of all functions used in program() */
 
-bool factor(void);
-bool exprPrefix(void);
-bool exprMul(void);
-bool exprAdd(void);
-bool exprComp(void);
-bool exprAssign(void);
-bool exprLogic(void);
-bool expr(void);
-bool instr(void);
-bool funcParam(void);
-bool funcParams(void);
-bool block(void);
-bool defFunc(void);
-bool baseType(void);
-bool defVar(void);
-bool program(void);
+int factor(Compiler *c);
+int exprPrefix(Compiler *c);
+int exprPrec(Compiler *c, int minPrec);
+int expr(Compiler *c);
+int instr(Compiler *c);
+int funcParam(Compiler *c);
+int funcParams(Compiler *c);
+int block(Compiler *c);
+int defFunc(Compiler *c);
+static void skipFunc(Compiler *c);
+int baseType(Compiler *c);
+int defVar(Compiler *c);
+void program(Compiler *c);
 
 /**
- * @brief same as err, but also prints the line of the current token
+ * @brief same as compileErr, with the line of the current token
  * @param[in] *fmt format of the error message @code "%s" @endcode
  * @param[in] ... variable number of error messages
  */
-_Noreturn void tkerr(const char *fmt, ...)
+_Noreturn void tkerr(Compiler *c, const char *fmt, ...)
 {
-	fprintf(stderr, "error in line %d: ", tokens[iTk].line);
+	if (traceLevel)
+		traceDump(stderr);
 	va_list va;
 	va_start(va, fmt);
-	vfprintf(stderr, fmt, va);
-	va_end(va);
-	fprintf(stderr, "\n");
-	exit(EXIT_FAILURE);
+	compileVErr(c, tkLine(&c->tokens, c->iTk), fmt, va);
 }
 
 /**
@@ -64,33 +72,38 @@ _Noreturn void tkerr(const char *fmt, ...)
  * @see enum atoms
  * @param[in] code code of atom
  */
-bool consume(int code)
+bool consume(Compiler *c, int code)
 {
-	printf("consume(%s)", ATOMS_CODE_NAME[code]);
-	if (tokens[iTk].code == code)
+	if (tkCode(&c->tokens, c->iTk) == code)
 	{
-		consumed = &tokens[iTk++];
-		printf(" => consumed\n");
+		c->consumed = c->iTk++;
+		TRACE(TRACE_TOKENS, TR_CONSUME, NULL, tkLine(&c->tokens, c->consumed), code, 0);
 		return true;
 	}
-	printf(" => at line %d: found %s", tokens[iTk].line, ATOMS_CODE_NAME[tokens[iTk].code]);
-	if (iTk - 1 >= 0)
-	{
-		char *details = (tokens[iTk - 1].code == 0) ? ", after %s = %s\n" : ", after %s\n";
-		printf(details, ATOMS_CODE_NAME[tokens[iTk - 1].code], tokens[iTk - 1].text);
-	}
-
+	TRACE(TRACE_TOKENS, TR_MISS, NULL, tkLine(&c->tokens, c->iTk), code, tkCode(&c->tokens, c->iTk));
 	return false;
 }
 
+/**
+ * @brief Tests if the current token can begin a rule
+ * @param[in] first the FIRST set of the rule
+ * @return true if the current token is in @p first
+ */
+static inline bool lookahead(Compiler *c, unsigned long long first)
+{
+	return (first >> tkCode(&c->tokens, c->iTk)) & 1;
+}
+
 /**
  * @brief Starts the syntactic analyser
- * @note Call this function to start Syntactic Analyser
+ * @note Call this function to start Syntactic Analyser.
+ * Every top level item (a variable, a function or an instruction) is parsed into an AST,
+ * which is passed to the types analysis and to the code generation and then it is deleted.
  */
-void parse()
+void parse(Compiler *c)
 {
-	iTk = 0;
-	program();
+	c->iTk = 0;
+	program(c);
 }
 
 // ---------------------------------------------------
@@ -100,468 +113,259 @@ void parse()
 /**
  * @brief program ::= ( defVar | defFunc | block )* FINISH
  */
-bool program()
+void program(Compiler *c)
 {
-	printf("\n-============ program ===============-\n\n");
+	TRACE_ENTER();
 
-	addDomain();
+	addDomain(c);
 	ILOG("Added new domain.\n");
-	addPredefinedFns();
-	ILOG("Added predefined funtions.\n");
-	crtCode = &tMain;
-	crtVar = &tBegin;
-	Text_write(&tBegin, "#include \"quick.h\"\n\n");
-	Text_write(&tMain, "\nint main(){\n");
+	c->crtCode = &c->tMain;
+	c->crtVar = &c->tBegin;
+	Text_write(&c->tBegin, "#include \"quick.h\"\n\n");
+	Text_write(&c->tMain, "\nint main(){\n");
 
 	for (;;)
 	{
-		if (defVar())
+		int item;
+		switch (tkCode(&c->tokens, c->iTk))
 		{
-			if (consume(FINISH))
-			{
-				printf("\n-============ end program ===============-\n\n");
-				delDomain();
-				Text_write(&tMain, "return 0;\n}\n");
-				FILE *fis = fopen("/gen-code/1.c", "w");
-				if (!fis)
-				{
-					printf("cannot write to file 1.c\n");
-					exit(EXIT_FAILURE);
-				}
-				fwrite(tBegin.buf, sizeof(char), tBegin.n, fis);
-				fwrite(tFunctions.buf, sizeof(char), tFunctions.n, fis);
-				fwrite(tMain.buf, sizeof(char), tMain.n, fis);
-				fclose(fis);
-				return true;
-			}
-		}
-		else if (defFunc())
-		{
-			if (consume(FINISH))
+		case VAR:
+			item = defVar(c);
+			break;
+		case FUNCTION:
+			if (c->splitFns)
 			{
-				printf("\n-============ end program ===============-\n\n");
-				delDomain();
-				Text_write(&tMain, "return 0;\n}\n");
-				FILE *fis = fopen("gen-code/1.c", "w");
-				if (!fis)
-				{
-					ELOG("cannot write to 'gen-code/1.c'\n");
-					exit(EXIT_FAILURE);
-				}
-				fwrite(tBegin.buf, sizeof(char), tBegin.n, fis);
-				fwrite(tFunctions.buf, sizeof(char), tFunctions.n, fis);
-				fwrite(tMain.buf, sizeof(char), tMain.n, fis);
-				fclose(fis);
-				return true;
+				skipFunc(c);
+				item = NO_NODE;
 			}
-		}
-		else if (block())
-		{
-			if (consume(FINISH))
+			else
 			{
-				printf("\n-============ end program ===============-\n\n");
-				delDomain();
-				Text_write(&tMain, "return 0;\n}\n");
-				FILE *fis = fopen("gen-code/1.c", "w");
-				if (!fis)
-				{
-					ELOG("cannot write to file 'gen-code/1.c'\n");
-					exit(EXIT_FAILURE);
-				}
-				fwrite(tBegin.buf, sizeof(char), tBegin.n, fis);
-				fwrite(tFunctions.buf, sizeof(char), tFunctions.n, fis);
-				fwrite(tMain.buf, sizeof(char), tMain.n, fis);
-				fclose(fis);
-				return true;
+				item = defFunc(c);
 			}
-		}
-		else
 			break;
-	}
-	if (consume(FINISH))
-	{
-		printf("\n-============ end program ===============-\n\n");
-		delDomain();
-		Text_write(&tMain, "return 0;\n}\n");
-		FILE *fis = fopen("gen-code/1.c", "w");
-		if (!fis)
-		{
-			ELOG("cannot write to file 'gen-code/1.c'\n");
-			exit(EXIT_FAILURE);
-		}
-
-		fwrite(tBegin.buf, sizeof(char), tBegin.n, fis);
-		fwrite(tFunctions.buf, sizeof(char), tFunctions.n, fis);
-		fwrite(tMain.buf, sizeof(char), tMain.n, fis);
-		fclose(fis);
-		return true;
-	}
-	else if (strcmp(ATOMS_CODE_NAME[tokens[iTk].code], "ID") == 0)
-	{
-		tkerr("unexpected token '%s', waiting for 'var', 'function' or instruction block", tokens[iTk].text);
-	}
-	else
-	{
-		tkerr("unexpected token '%s', waiting for 'var', 'function' or instruction block", ATOMS_CODE_NAME[tokens[iTk].code]);
+		case FINISH:
+			if (c->splitFns)
+				compileFns(c);
+			TRACE_EXIT();
+			consume(c, FINISH);
+			delDomain(c);
+			Text_write(&c->tMain, "return 0;\n}\n");
+			return;
+		default:
+			if (!lookahead(c, FIRST_INSTR))
+				tkerr(c, "unexpected token '%s', waiting for 'var', 'function' or instruction block", tkText(&c->tokens, c->iTk));
+			item = instr(c);
+		}
+		if (item != NO_NODE)
+		{
+			checkItem(c, item);
+			genItem(c, item);
+		}
+		astReset(&c->ast);
+		spillCode(c);
 	}
 }
 
 /**
  * @brief defVar ::= VAR ID COLON baseType SEMICOLON
  */
-bool defVar()
+int defVar(Compiler *c)
 {
-	printf("\n-============ defVar ===============-\n\n");
-
-	int start = iTk;
-	if (consume(VAR))
-	{
-		if (consume(ID))
-		{
-			const char *name = consumed->text;
-			Symbol *s = searchInCurrentDomain(name);
-			if (s)
-			{
-				ELOG("symbol redefinition: %s\n", name);
-				tkerr("symbol redefinition: %s", name);
-			}
-			s = addSymbol(name, KIND_VAR);
-			s->local = crtFn != NULL;
-			if (consume(COLON))
-			{
-				if (baseType())
-				{
-					s->type = ret.type;
-					if (consume(SEMICOLON))
-					{
-						Text_write(crtVar, "%s %s;\n", cType(ret.type), name);
-						ILOG("%s %s;\n", cType(ret.type), name);
-						printf("\n-============ end defVar ===============-\n\n");
-						return true;
-					}
-					else
-					{
-						printf("iTk = %d\n", iTk);
-						tkerr("missing token ';', after data type definition\n");
-					}
-				}
-				else
-				{
-					printf("iTk = %d\n", iTk);
-					tkerr("missing data type definition\n");
-				}
-			}
-			else
-			{
-				printf("iTk = %d\n", iTk);
-				tkerr("missing token ':, after '%s'\n", tokens[iTk].text);
-			}
-		}
-		else
-		{
-			printf("iTk = %d\n", iTk);
-			tkerr("missing id at variable definition/declaration\n");
-		}
-	}
-	else
-	{
-		// printf("iTk = %d\n", iTk);
-		// tkerr("missing token 'var'\n");
-	}
+	TRACE_ENTER();
+
+	consume(c, VAR);
+	if (!consume(c, ID))
+		tkerr(c, "missing id at variable definition/declaration\n");
+	int node = addNode(&c->ast, N_VAR, tkLine(&c->tokens, c->consumed));
+	NODE(&c->ast, node)->val.id = tkId(&c->tokens, c->consumed);
+	if (!consume(c, COLON))
+		tkerr(c, "missing token ':', after '%s'\n", tkText(&c->tokens, c->consumed));
+	NODE(&c->ast, node)->declType = baseType(c);
+	if (!consume(c, SEMICOLON))
+		tkerr(c, "missing token ';', after data type definition\n");
+
+	TRACE_EXIT();
+	return node;
+}
 
-	iTk = start;
-	printf("\n-============ end defVar ===============-\n\n");
-	return false;
+/**
+ * @brief the header of defFunc: FUNCTION ID LPAR funcParams? RPAR COLON baseType
+ * @return the N_FUNC node, without local vars and body
+ */
+static int funcHeader(Compiler *c)
+{
+	consume(c, FUNCTION);
+	if (!consume(c, ID))
+		tkerr(c, "missing function name\n");
+	int node = addNode(&c->ast, N_FUNC, tkLine(&c->tokens, c->consumed));
+	NODE(&c->ast, node)->val.id = tkId(&c->tokens, c->consumed);
+
+	if (!consume(c, LPAR))
+		tkerr(c, "missing token '(', after '%s'\n", tkText(&c->tokens, c->consumed));
+	int params = NO_NODE;
+	if (tkCode(&c->tokens, c->iTk) == ID)
+		params = funcParams(c);
+	NODE(&c->ast, node)->a = params;
+	if (!consume(c, RPAR))
+		tkerr(c, "missing token ')'\n");
+	if (!consume(c, COLON))
+		tkerr(c, "missing token ':', after ')'\n");
+	NODE(&c->ast, node)->declType = baseType(c);
+	return node;
 }
 
 /**
  * @brief defFunc ::= FUNCTION ID LPAR funcParams? RPAR COLON baseType defVar* block END
  */
-bool defFunc()
+int defFunc(Compiler *c)
 {
-	printf("\n-============ defFunc ===============-\n\n");
+	TRACE_ENTER();
 
-	int start = iTk;
-
-	if (consume(FUNCTION))
+	int node = funcHeader(c);
+	int firstVar = NO_NODE, lastVar = NO_NODE;
+	while (tkCode(&c->tokens, c->iTk) == VAR)
 	{
-		if (consume(ID))
-		{
-			const char *name = consumed->text;
-			Symbol *s = searchInCurrentDomain(name);
-			if (s)
-			{
-				ELOG("symbol redefinition: %s", name);
-				tkerr("symbol redefinition: %s", name);
-			}
-			crtFn = addSymbol(name, KIND_FN);
-			crtFn->args = NULL;
-			addDomain();
+		int var = defVar(c);
+		appendNode(&c->ast, &firstVar, &lastVar, var);
+	}
+	NODE(&c->ast, node)->b = firstVar;
+	if (!lookahead(c, FIRST_INSTR))
+		tkerr(c, "missing block of instruction for function definition\n");
+	int body = block(c);
+	NODE(&c->ast, node)->c = body;
+	if (!consume(c, END))
+		tkerr(c, "missing token 'end'\n");
 
-			crtCode = &tFunctions;
-			crtVar = &tFunctions;
-			Text_clear(&tFnHeader);
-			Text_write(&tFnHeader, "%s(", name);
-			ILOG("%s(", name);
+	TRACE_EXIT();
+	return node;
+}
 
-			if (consume(LPAR))
-			{
-				if (funcParams())
-				{
-				}
-				if (consume(RPAR))
-				{
-					if (consume(COLON))
-					{
-						if (baseType())
-						{
-							crtFn->type = ret.type;
-							Text_write(&tFunctions, "\n%s %s){\n", cType(ret.type), tFnHeader.buf);
-							ILOG("\n%s %s){\n", cType(ret.type), tFnHeader.buf);
-
-							while (defVar())
-							{
-								if (block())
-								{
-									if (consume(END))
-									{
-										printf("\n-============ end defFunc ===============-\n\n");
-										delDomain();
-										crtFn = NULL;
-
-										Text_write(&tFunctions, "}\n");
-										crtCode = &tMain;
-										crtVar = &tBegin;
-
-										return true;
-									}
-									else
-									{
-										printf("iTk = %d\n", iTk);
-										tkerr("missing token 'end'\n");
-									}
-								}
-							}
-							if (block())
-							{
-								if (consume(END))
-								{
-									printf("\n-============ end defFunc ===============-\n\n");
-									delDomain();
-									crtFn = NULL;
-
-									Text_write(&tFunctions, "}\n");
-									crtCode = &tMain;
-									crtVar = &tBegin;
-
-									return true;
-								}
-								else
-								{
-									printf("iTk = %d\n", iTk);
-									tkerr("missing token 'end'\n");
-								}
-							}
-							else
-							{
-								printf("iTk = %d\n", iTk);
-								tkerr("missing block of instruction for function definition\n");
-							}
-						}
-					}
-					else
-					{
-						printf("iTk = %d\n", iTk);
-						tkerr("missing token ':', after ')\n");
-					}
-				}
-				else
-				{
-					printf("iTk = %d\n", iTk);
-					tkerr("missing token ')'\n");
-				}
-			}
-			else
-			{
-				printf("iTk = %d\n", iTk);
-				tkerr("missing token '(', after '%s'\n", tokens[iTk - 1].text);
-			}
-		}
-		else
+/**
+ * @brief a function whose body is compiled later, in parallel with the others (see compileFns)
+ * Only its header is parsed now and its symbol is defined, so the code which follows sees it
+ * like in the serial compilation. The body is skipped up to the END which closes it,
+ * counting the IF and WHILE, which also end with END. The syntax of the body is checked
+ * by its function job.
+ */
+static void skipFunc(Compiler *c)
+{
+	TRACE_ENTER();
+
+	int firstTk = c->iTk;
+	int node = funcHeader(c);
+	int order = declareFunc(c, node)->order;
+	for (int depth = 1; depth;)
+	{
+		switch (tkCode(&c->tokens, c->iTk))
 		{
-			printf("iTk = %d\n", iTk);
-			tkerr("missing function name\n");
+		case IF:
+		case WHILE:
+			depth++;
+			break;
+		case END:
+			depth--;
+			break;
+		case FINISH:
+			tkerr(c, "missing token 'end'\n");
 		}
+		c->consumed = c->iTk++;
 	}
-	else
-	{
-		// printf("iTk = %d\n", iTk);
-		// tkerr("missing token 'function'\n");
-	}
+	addFnJob(c, firstTk, c->iTk, order);
 
-	iTk = start;
-	printf("\n-============ end defFunc ===============-\n\n");
-	return false;
+	TRACE_EXIT();
 }
 
 /**
  * @brief block ::= instr+
+ * @return the first instruction of the list
  */
-bool block()
+int block(Compiler *c)
 {
-	printf("\n-============ block ===============-\n\n");
-
-	int start = iTk;
+	TRACE_ENTER();
 
-	if (instr())
+	int first = NO_NODE, last = NO_NODE;
+	do
 	{
-	}
-	else
-	{
-		printf("iTk = %d\n", iTk);
-		// tkerr("instruction has not been found\n");
-		iTk = start;
-		printf("\n-============ end block ===============-\n\n");
-		return false;
-	}
-
-	while (instr())
-	{
-	}
+		int node = instr(c);
+		if (node != NO_NODE)
+			appendNode(&c->ast, &first, &last, node);
+	} while (lookahead(c, FIRST_INSTR));
 
-	printf("\n-============ end block ===============-\n\n");
-	return true;
+	TRACE_EXIT();
+	return first;
 }
 
 /**
  * @brief baseType ::= TYPE_INT | TYPE_REAL | TYPE_STR
+ * @return the type code
  */
-bool baseType()
+int baseType(Compiler *c)
 {
-	printf("\n-============ baseType ===============-\n\n");
+	TRACE_ENTER();
 
-	int start = iTk; // Detailed description after the member
-	if (consume(TYPE_INT))
-	{
-		printf("\n-============ end baseType ===============-\n\n");
-		ret.type = TYPE_INT;
-		return true;
-	}
-	else if (consume(TYPE_REAL))
-	{
-		printf("\n-============ end baseType ===============-\n\n");
-		ret.type = TYPE_REAL;
-		return true;
-	}
-	else if (consume(TYPE_STR))
-	{
-		printf("\n-============ end baseType ===============-\n\n");
-		ret.type = TYPE_STR;
-		return true;
-	}
-	else
-	{
-		iTk = start;
-		tkerr("undefined or inexistent type of data\n");
-		printf("\n-============ end baseType ===============-\n\n");
-		return false;
-	}
+	int type = tkCode(&c->tokens, c->iTk);
+	if (type != TYPE_INT && type != TYPE_REAL && type != TYPE_STR)
+		tkerr(c, "undefined or inexistent type of data\n");
+	consume(c, type);
+
+	TRACE_EXIT();
+	return type;
 }
 
 /**
  * @brief funcParams ::= funcParam ( COMMA funcParam )*
+ * @return the first param of the list
  */
-bool funcParams()
+int funcParams(Compiler *c)
 {
-	printf("\n-============ funcParams ===============-\n\n");
-
-	int start = iTk;
+	TRACE_ENTER();
 
-	if (funcParam())
+	int first = NO_NODE, last = NO_NODE;
+	do
 	{
-		while (true)
-		{
-			if (consume(COMMA))
-			{
-				Text_write(&tFnHeader, ",");
-				if (funcParam())
-				{
-					start = iTk;
-				}
-			}
-			else
-			{
-				if (consume(RPAR) != true)
-				{
-					printf("iTk = %d\n", iTk - 1);
-					tkerr("missing token ',', after '%s'\n", ATOMS_CODE_NAME[tokens[iTk - 2].code]);
-				}
-				else
-				{
-					iTk--;
-					printf("\n-============ end funcParams ===============-\n\n");
-					return true;
-				}
-			}
-		}
+		int param = funcParam(c);
+		appendNode(&c->ast, &first, &last, param);
+	} while (consume(c, COMMA));
+	if (tkCode(&c->tokens, c->iTk) == ID)
+		tkerr(c, "missing token ',', after '%s'\n", ATOMS_CODE_NAME[tkCode(&c->tokens, c->iTk - 1)]);
 
-		printf("\n-============ end funcParams ===============-\n\n");
-		return true;
-	}
-
-	iTk = start;
-	printf("\n-============ end funcParams ===============-\n\n");
-	return false;
+	TRACE_EXIT();
+	return first;
 }
 
 /**
  * @brief funcParam ::= ID COLON baseType
  */
-bool funcParam()
+int funcParam(Compiler *c)
 {
-	printf("\n-============ funcParam ===============-\n\n");
-
-	int start = iTk;
-
-	if (consume(ID))
-	{
-		const char *name = consumed->text;
-		Symbol *s = searchInCurrentDomain(name);
-		if (s)
-		{
-			ELOG("symbol redefinition: %s", name);
-			tkerr("symbol redefinition: %s", name);
-		}
-		s = addSymbol(name, KIND_ARG);
-		Symbol *sFnParam = addFnArg(crtFn, name);
-
-		if (consume(COLON))
-		{
-			if (baseType())
-			{
-				printf("\n-============ end funcParam ===============-\n\n");
-				s->type = ret.type;
-				sFnParam->type = ret.type;
-
-				Text_write(&tFnHeader, "%s %s", cType(ret.type), name);
-				return true;
-			}
-		}
-		else
-		{
-			printf("iTk = %d\n", iTk);
-			tkerr("missing token ':', after '%s'\n", tokens[iTk - 1].text);
-		}
-	}
-	else
-	{
-		printf("iTk = %d\n", iTk);
-		tkerr("missing 'id' at func. param. declaration\n");
-	}
+	TRACE_ENTER();
+
+	if (!consume(c, ID))
+		tkerr(c, "missing 'id' at func. param. declaration\n");
+	int node = addNode(&c->ast, N_PARAM, tkLine(&c->tokens, c->consumed));
+	NODE(&c->ast, node)->val.id = tkId(&c->tokens, c->consumed);
+	if (!consume(c, COLON))
+		tkerr(c, "missing token ':', after '%s'\n", tkText(&c->tokens, c->consumed));
+	NODE(&c->ast, node)->declType = baseType(c);
+
+	TRACE_EXIT();
+	return node;
+}
 
-	iTk = start;
-	printf("\n-============ end funcParam ===============-\n\n");
-	return false;
+/**
+ * @brief parses "LPAR expr RPAR", the condition of IF and WHILE
+ * @param[in] name the instruction name, for error messages
+ */
+static int condition(Compiler *c, const char *name)
+{
+	if (!consume(c, LPAR))
+		tkerr(c, "missing token '(', after '%s'\n", name);
+	if (!lookahead(c, FIRST_EXPR))
+		tkerr(c, "missing expr in %s\n", name);
+	int cond = expr(c);
+	if (!consume(c, RPAR))
+		tkerr(c, "missing token ')', after expr\n");
+	return cond;
 }
 
 /**
@@ -569,751 +373,281 @@ bool funcParam()
  *		| IF LPAR expr RPAR block ( ELSE block )? END
  *		| RETURN expr SEMICOLON
  *		| WHILE LPAR expr RPAR block END
+ * @return the instruction node or NO_NODE for an empty instruction
  */
-bool instr()
+int instr(Compiler *c)
 {
-	printf("\n-============ instr ===============-\n\n");
-
-	int start = iTk;
-
-	if (consume(WHILE))
-	{
-		if (consume(LPAR))
-		{
-			Text_write(crtCode, "while(");
-			if (expr())
-			{
-				if (ret.type == TYPE_STR)
-				{
-					ELOG("WHILE condition must have TYPE_INT or TYPE_REAL\n");
-					tkerr("the while condition must have type int or real");
-				}
+	TRACE_ENTER();
 
-				if (consume(RPAR))
-				{
-					Text_write(crtCode, "){\n");
-					if (block())
-					{
-						if (consume(END))
-						{
-							Text_write(crtCode, "}\n");
-							printf("\n-============ end instr ===============-\n\n");
-							return true;
-						}
-						else
-						{
-							printf("iTk = %d\n", iTk);
-							tkerr("missing token 'end', after block\n");
-						}
-					}
-					else
-					{
-						printf("iTk = %d\n", iTk);
-						tkerr("missing block of expr in while loop\n");
-					}
-				}
-				else
-				{
-					printf("iTk = %d\n", iTk);
-					tkerr("missing token ')', after expr\n");
-				}
-			}
-			else
-			{
-				printf("iTk = %d\n", iTk);
-				tkerr("missing expr in while loop\n");
-			}
-		}
-		else
-		{
-			printf("iTk = %d\n", iTk);
-			tkerr("missing token '(', after '%s'\n", ATOMS_CODE_NAME[tokens[iTk - 1].code]);
-		}
-	}
-
-	if (consume(IF))
+	int node = NO_NODE;
+	switch (tkCode(&c->tokens, c->iTk))
 	{
-		if (consume(LPAR))
-		{
-			Text_write(crtCode, "if(");
-			if (expr())
-			{
-				if (ret.type == TYPE_STR)
-				{
-					ELOG("IF cond myst have TYPE_INT or TYPE_REAL\n");
-					tkerr("the if condition must have type int or real");
-				}
-				if (consume(RPAR))
-				{
-					Text_write(crtCode, "){\n");
-					if (block())
-					{
-						Text_write(crtCode, "}\n");
-
-						if (consume(ELSE))
-						{
-							Text_write(crtCode, "else{\n");
-							if (block())
-							{
-								Text_write(crtCode, "}\n");
-
-								if (consume(END))
-								{
-									printf("\n-============ end instr ===============-\n\n");
-									return true;
-								}
-							}
-							else
-							{
-								printf("iTk = %d\n", iTk);
-								tkerr("missing block of expr in else branch\n");
-							}
-						}
-						if (consume(END))
-						{
-							printf("\n-============ end instr ===============-\n\n");
-							return true;
-						}
-					}
-					else
-					{
-						printf("iTk = %d\n", iTk);
-						tkerr("missing block of expr in if statement \n");
-					}
-				}
-				else
-				{
-					printf("iTk = %d\n", iTk);
-					tkerr("missing token ')', after expr\n");
-				}
-			}
-			else
-			{
-				printf("iTk = %d\n", iTk);
-				tkerr("missing expr in if statement\n");
-			}
-		}
-		else
-		{
-			printf("iTk = %d\n", iTk);
-			tkerr("missing token '(', after '%s'\n", ATOMS_CODE_NAME[tokens[iTk - 1].code]);
-		}
-	}
-
-	if (consume(RETURN))
+	case WHILE:
 	{
-		Text_write(crtCode, "return ");
-		if (expr())
-		{
-			if (!crtFn)
-				tkerr("return can be used only in a function");
-			if (ret.type != crtFn->type)
-				tkerr("the return type must be the same as the function return type");
-
-			if (consume(SEMICOLON))
-			{
-				Text_write(crtCode, ";\n");
-				printf("\n-============ end instr ===============-\n\n");
-				return true;
-			}
-			else
-			{
-				printf("iTk = %d\n", iTk);
-				tkerr("missing token ';' after expr, received '%s'\n", ATOMS_CODE_NAME[tokens[iTk].code]);
-			}
-		}
-		else
-		{
-			printf("iTk = %d\n", iTk);
-			tkerr("missing after 'return' expr\n");
-		}
+		consume(c, WHILE);
+		node = addNode(&c->ast, N_WHILE, tkLine(&c->tokens, c->consumed));
+		int cond = condition(c, "while");
+		NODE(&c->ast, node)->a = cond;
+		if (!lookahead(c, FIRST_INSTR))
+			tkerr(c, "missing block of expr in while loop\n");
+		int body = block(c);
+		NODE(&c->ast, node)->b = body;
+		if (!consume(c, END))
+			tkerr(c, "missing token 'end', after block\n");
+		break;
 	}
 
-	if (expr())
+	case IF:
 	{
-		if (consume(SEMICOLON))
-		{
-			Text_write(crtCode, ";\n");
-			printf("\n-============ end instr ===============-\n\n");
-			return true;
-		}
-		else
+		consume(c, IF);
+		node = addNode(&c->ast, N_IF, tkLine(&c->tokens, c->consumed));
+		int cond = condition(c, "if");
+		NODE(&c->ast, node)->a = cond;
+		if (!lookahead(c, FIRST_INSTR))
+			tkerr(c, "missing block of expr in if statement \n");
+		int then = block(c);
+		NODE(&c->ast, node)->b = then;
+		if (consume(c, ELSE))
 		{
-			if (consume(COLON))
-			{
-				return false;
-			}
-			printf("iTk = %d\n", iTk);
-			tkerr("missing token ';' after expr, received '%s'\n", ATOMS_CODE_NAME[tokens[iTk].code]);
+			if (!lookahead(c, FIRST_INSTR))
+				tkerr(c, "missing block of expr in else branch\n");
+			int other = block(c);
+			NODE(&c->ast, node)->c = other;
 		}
+		if (!consume(c, END))
+			tkerr(c, "missing token 'end', after block\n");
+		break;
 	}
 
-	if (consume(SEMICOLON))
+	case RETURN:
 	{
-		printf("\n-============ end instr ===============-\n\n");
-		return true;
+		consume(c, RETURN);
+		node = addNode(&c->ast, N_RETURN, tkLine(&c->tokens, c->consumed));
+		if (!lookahead(c, FIRST_EXPR))
+			tkerr(c, "missing after 'return' expr\n");
+		int e = expr(c);
+		NODE(&c->ast, node)->a = e;
+		if (!consume(c, SEMICOLON))
+			tkerr(c, "missing token ';' after expr, received '%s'\n", ATOMS_CODE_NAME[tkCode(&c->tokens, c->iTk)]);
+		break;
 	}
 
-	iTk = start;
-	printf("\n-============ end instr ===============-\n\n");
-	return false;
-}
-
-/**
- * @brief expr ::= exprLogic
- */
-bool expr()
-{
-	printf("\n-============ expr ===============-\n\n");
-
-	int start = iTk;
+	case SEMICOLON:
+		consume(c, SEMICOLON);
+		break;
 
-	if (exprLogic())
+	default:
 	{
-		printf("\n-============ end expr ===============-\n\n");
-		return true;
+		if (!lookahead(c, FIRST_EXPR))
+			tkerr(c, "unexpected token '%s', waiting for an instruction", tkText(&c->tokens, c->iTk));
+		node = addNode(&c->ast, N_EXPR, tkLine(&c->tokens, c->iTk));
+		int e = expr(c);
+		NODE(&c->ast, node)->a = e;
+		if (!consume(c, SEMICOLON))
+			tkerr(c, "missing token ';' after expr, received '%s'\n", ATOMS_CODE_NAME[tkCode(&c->tokens, c->iTk)]);
 	}
-
-	iTk = start;
-	printf("\n-============ end expr ===============-\n\n");
-	return false;
-}
-
-/**
- * @brief exprLogic ::= exprAssign ( ( AND | OR ) exprAssign )*
- */
-bool exprLogic()
-{
-	printf("\n-============ exprLogic ===============-\n\n");
-
-	int start = iTk;
-
-	if (exprAssign())
-	{
-		while (true)
-		{
-			if (consume(AND))
-			{
-				Ret leftType = ret;
-				if (leftType.type == TYPE_STR)
-					tkerr("the left operand of && cannot be of type str");
-				ILOG("[AT] left operand has a valid data type '%s'\n", ATOMS_CODE_NAME[leftType.type]);
-				Text_write(crtCode, "&&");
-
-				if (exprAssign())
-				{
-					if (ret.type == TYPE_STR)
-						tkerr("the right operand of && cannot be of type str");
-					setRet(TYPE_INT, false);
-					ILOG("[AT] right operand has a valid data type '%s'\n", ATOMS_CODE_NAME[leftType.type]);
-				}
-				else
-				{
-					printf("iTk = %d\n", iTk);
-					tkerr("missing expression after '&&' operator\n");
-				}
-			}
-
-			if (consume(OR))
-			{
-				Ret leftType = ret;
-				if (leftType.type == TYPE_STR)
-					tkerr("the left operand of || cannot be of type str");
-				ILOG("[AT] left operand has a valid data type '%s'\n", ATOMS_CODE_NAME[leftType.type]);
-				Text_write(crtCode, "||");
-
-				if (exprAssign())
-				{
-					if (ret.type == TYPE_STR)
-						tkerr("the right operand of || cannot be of type str");
-					ILOG("[AT] right operand has a valid data type '%s'\n", ATOMS_CODE_NAME[leftType.type]);
-					setRet(TYPE_INT, false);
-				}
-				else
-				{
-					printf("iTk = %d\n", iTk);
-					tkerr("missing expression after '||' operator\n");
-				}
-			}
-
-			if (!consume(OR) && !consume(AND))
-			{
-				break;
-			}
-		}
-		printf("\n-============ end ===============-\n\n");
-		return true;
 	}
 
-	iTk = start;
-	printf("\n-============ end exprLogic ===============-\n\n");
-	return false;
+	TRACE_EXIT();
+	return node;
 }
 
 /**
- * @brief exprAssign ::= ( ID ASSIGN )? exprComp
+ * @brief adds a node for a binary operator
  */
-bool exprAssign()
+static int binaryNode(Compiler *c, int op, int line, int left, int right)
 {
-	printf("\n-============ exprAssign ===============-\n\n");
-
-	int start = iTk;
-
-	if (consume(ID))
-	{
-		const char *name = consumed->text;
-		ILOG("[AT] added %s id\n", name);
-		if (consume(ASSIGN))
-		{
-			Text_write(crtCode, "%s=", name);
-			if (exprComp())
-			{
-				Symbol *s = searchSymbol(name);
-				if (!s)
-					tkerr("undefined symbol: %s", name);
-				if (s->kind == KIND_FN)
-					tkerr("a function (%s) cannot be used as a destination for assignment ", name);
-				if (s->type != ret.type)
-					tkerr("the source and destination for assignment must have the same type");
-				ret.lval = false;
-				ILOG("[AT] found valid symbol %s\n", name);
-				printf("\n-============ end exprAssign ===============-\n\n");
-				return true;
-			}
-		}
-		else
-		{
-			iTk--;
-		}
-	}
-
-	if (consume(ASSIGN))
-	{
-		printf("iTk = %d\n", iTk);
-		tkerr("missing id in front of '='\n");
-	}
-
-	if (exprComp())
-	{
-		printf("\n-============ end exprAssign ===============-\n\n");
-		return true;
-	}
-
-	iTk = start;
-	printf("\n-============ end exprAssign ===============-\n\n");
-	return false;
+	int node = addNode(&c->ast, N_BINARY, line);
+	NODE(&c->ast, node)->op = op;
+	NODE(&c->ast, node)->a = left;
+	NODE(&c->ast, node)->b = right;
+	return node;
 }
 
 /**
- * @brief exprComp ::= exprAdd ( ( LESS | EQUAL ) exprAdd )?
+ * @brief the binding power of the binary operators
+ * @note a higher value binds stronger; PREC_NONE is for the tokens which are not binary operators
  */
-bool exprComp()
+enum
 {
-	printf("\n-============ exprComp ===============-\n\n");
-
-	int start = iTk;
-
-	if (exprAdd())
-	{
-		if (consume(LESS))
-		{
-			Ret leftType = ret;
-			Text_write(crtCode, "<");
-
-			if (exprAdd())
-			{
-				if (leftType.type != ret.type)
-					tkerr("different types for the operands of <");
-				setRet(TYPE_INT, false); // the result of comparation is int 0 or 1
-				printf("\n-============ end exprComp ===============-\n\n");
-				return true;
-			}
-			else
-			{
-				printf("iTk = %d\n", iTk);
-				tkerr("missing expression after '<' operator\n");
-			}
-		}
-
-		if (consume(EQUAL))
-		{
-			Ret leftType = ret;
-			Text_write(crtCode, "==");
-
-			if (exprAdd())
-			{
-				if (leftType.type != ret.type)
-					tkerr("different types for the operands of ==");
-				setRet(TYPE_INT, false); // the result of comparation is int 0 or 1
-				printf("\n-============ end exprComp ===============-\n\n");
-				return true;
-			}
-			else
-			{
-				printf("iTk = %d\n", iTk);
-				tkerr("missing expression after '==' operator\n");
-			}
-		}
-
-		printf("\n-============ end exprComp ===============-\n\n");
-		return true;
-	}
-
-	iTk = start;
-	printf("\n-============ end exprComp ===============-\n\n");
-	return false;
-}
+	PREC_NONE,
+	PREC_LOGIC,	 // AND OR
+	PREC_ASSIGN, // ASSIGN, only with an ID at left and a comparison at most at right
+	PREC_COMP,	 // LESS EQUAL, which cannot be chained
+	PREC_ADD,	 // ADD SUB
+	PREC_MUL	 // MUL DIV
+};
+
+/** @brief the binding power of every token, indexed by the token code */
+static const unsigned char binPrec[GREATERQ + 1] = {
+	[OR] = PREC_LOGIC,
+	[AND] = PREC_LOGIC,
+	[ASSIGN] = PREC_ASSIGN,
+	[LESS] = PREC_COMP,
+	[EQUAL] = PREC_COMP,
+	[ADD] = PREC_ADD,
+	[SUB] = PREC_ADD,
+	[MUL] = PREC_MUL,
+	[DIV] = PREC_MUL,
+};
 
 /**
- * @brief exprAdd ::= exprMul ( ( ADD | SUB ) exprMul )*
+ * @brief expr ::= exprPrefix ( binaryOp exprPrefix )*
+ * @note it is the same language as the chain of rules
+ * exprLogic ::= exprAssign ( ( AND | OR ) exprAssign )*
+ * exprAssign ::= ( ID ASSIGN )? exprComp
+ * exprComp ::= exprAdd ( ( LESS | EQUAL ) exprAdd )?
+ * exprAdd ::= exprMul ( ( ADD | SUB ) exprMul )*
+ * exprMul ::= exprPrefix ( ( MUL | DIV ) exprPrefix )*
+ * but it is parsed by precedence climbing, driven by binPrec, with a call only for each operator
  */
-bool exprAdd()
+int expr(Compiler *c)
 {
-	printf("\n-============ exprAdd ===============-\n\n");
-
-	int start = iTk;
-
-	if (exprMul())
-	{
-		while (true)
-		{
-
-			if (consume(ADD))
-			{
-				Ret leftType = ret;
-				if (leftType.type == TYPE_STR)
-					tkerr("the operands of + or - cannot be of type str");
-
-				Text_write(crtCode, "+");
-				if (exprMul())
-				{
-					if (leftType.type != ret.type)
-						tkerr("different types for the operands of +");
-					ret.lval = false;
-				}
-				else
-				{
-					printf("iTk = %d\n", iTk);
-					tkerr("missing right side operand for the '+' operator\n");
-				}
-			}
+	TRACE_ENTER();
 
-			if (consume(SUB))
-			{
-				Ret leftType = ret;
-				if (leftType.type == TYPE_STR)
-					tkerr("the operands of + or - cannot be of type str");
-
-				Text_write(crtCode, "-");
-				if (exprMul())
-				{
-					if (leftType.type != ret.type)
-						tkerr("different types for the operands of -");
-					ret.lval = false;
-				}
-				else
-				{
-					printf("iTk = %d\n", iTk);
-					tkerr("missing right side operand for the '-' operator\n");
-				}
-			}
-
-			if (!consume(ADD) && !consume(SUB))
-			{
-				break;
-			}
-		}
-
-		printf("\n-============ end exprAdd ===============-\n\n");
-		return true;
-	}
+	int node = exprPrec(c, PREC_LOGIC);
 
-	iTk = start;
-	printf("\n-============ end exprAdd ===============-\n\n");
-	return false;
+	TRACE_EXIT();
+	return node;
 }
 
 /**
- * @brief exprMul ::= exprPrefix ( ( MUL | DIV ) exprPrefix )*
+ * @brief parses an expression which contains only binary operators with the binding power >= minPrec
+ * @note all the operators are left associative: their right operand contains only operators which bind stronger
  */
-bool exprMul()
+int exprPrec(Compiler *c, int minPrec)
 {
-	printf("\n-============ exprMul ===============-\n\n");
-
-	int start = iTk;
-
-	if (exprPrefix())
+	int node = exprPrefix(c);
+	int prevPrec = PREC_NONE;
+	for (;;)
 	{
-		while (true)
+		int op = tkCode(&c->tokens, c->iTk);
+		int prec = binPrec[op];
+		if (prec == PREC_NONE || prec < minPrec)
+			break;
+		if (prec == PREC_COMP && prevPrec == PREC_COMP)
+			tkerr(c, "the operator '%s' cannot follow another comparison\n", ATOMS_SPELLING[op]);
+		consume(c, op);
+		int line = tkLine(&c->tokens, c->consumed);
+		if (!lookahead(c, FIRST_EXPR))
+			tkerr(c, "missing expression after '%s' operator\n", ATOMS_SPELLING[op]);
+		if (op == ASSIGN)
+		{
+			if (NODE(&c->ast, node)->kind != N_ID)
+				tkerr(c, "only a variable can be used as a destination for assignment");
+			int dst = node;
+			int src = exprPrec(c, PREC_COMP);
+			node = addNode(&c->ast, N_ASSIGN, line);
+			NODE(&c->ast, node)->a = dst;
+			NODE(&c->ast, node)->b = src;
+		}
+		else
 		{
-			if (consume(MUL))
-			{
-				Ret leftType = ret;
-				if (leftType.type == TYPE_STR)
-					tkerr("the operands of * cannot be of type str");
-
-				Text_write(crtCode, "*");
-
-				if (exprPrefix())
-				{
-					if (leftType.type != ret.type)
-						tkerr("different types for the operands of *");
-					ret.lval = false;
-				}
-				else
-				{
-					printf("iTk = %d\n", iTk);
-					tkerr("missing right side operand for the '*' operator\n");
-				}
-			}
-
-			if (consume(DIV))
-			{
-				Ret leftType = ret;
-				if (leftType.type == TYPE_STR)
-					tkerr("the operands of / cannot be of type str");
-
-				Text_write(crtCode, "/");
-
-				if (exprPrefix())
-				{
-					if (leftType.type != ret.type)
-						tkerr("different types for the operands /");
-					ret.lval = false;
-				}
-				else
-				{
-					printf("iTk = %d\n", iTk);
-					tkerr("missing right side operand for the '/' operator\n");
-				}
-			}
-
-			if (!consume(MUL) && !consume(DIV))
-			{
-				break;
-			}
+			int right = exprPrec(c, prec + 1);
+			node = binaryNode(c, op, line, node, right);
 		}
-
-		printf("\n-============ end exprMul ===============-\n\n");
-		return true;
+		prevPrec = prec;
 	}
-
-	iTk = start;
-	printf("\n-============ end exprMul ===============-\n\n");
-	return false;
+	return node;
 }
 
 /**
  * @brief exprPrefix ::= (SUB | NOT)? factor
  */
-bool exprPrefix()
+int exprPrefix(Compiler *c)
 {
-	printf("\n-============ exprPrefix ===============-\n\n");
+	TRACE_ENTER();
 
-	int start = iTk;
-
-	if (consume(SUB))
+	int node;
+	int op = tkCode(&c->tokens, c->iTk);
+	if (op == SUB || op == NOT)
 	{
-		Text_write(crtCode, "-");
-
-		if (factor())
-		{
-			if (ret.type == TYPE_STR)
-				tkerr("the expression of unary - must be of type int or real");
-			ret.lval = false;
-			printf("\n-============ end exprPrefix ===============-\n\n");
-			return true;
-		}
-		else
-		{
-			printf("iTk = %d\n", iTk);
-			tkerr("missing right side operand for the 'SUB'  operator\n");
-		}
+		consume(c, op);
+		node = addNode(&c->ast, N_UNARY, tkLine(&c->tokens, c->consumed));
+		NODE(&c->ast, node)->op = op;
+		if (!lookahead(c, FIRST_FACTOR))
+			tkerr(c, "missing right side operand for the '%s' operator\n", ATOMS_CODE_NAME[op]);
+		int operand = factor(c);
+		NODE(&c->ast, node)->a = operand;
 	}
-
-	if (consume(NOT))
-	{
-
-		Text_write(crtCode, "!");
-
-		if (factor())
-		{
-			if (ret.type == TYPE_STR)
-				tkerr("the expression of ! must be of type int or real");
-			setRet(TYPE_INT, false);
-			printf("\n-============ end exprPrefix ===============-\n\n");
-			return true;
-		}
-		else
-		{
-			printf("iTk = %d\n", iTk);
-			tkerr("missing right side operand for the 'NOT'  operator\n");
-		}
-	}
-
-	if (factor())
+	else
 	{
-		printf("\n-============ end exprPrefix ===============-\n\n");
-		return true;
+		node = factor(c);
 	}
 
-	iTk = start;
-	printf("\n-============ end exprPrefix ===============-\n\n");
-	return false;
+	TRACE_EXIT();
+	return node;
 }
 
 /**
  * factor ::= INT
-| REAL
-| STR
-| LPAR expr RPAR
-| ID ( LPAR ( expr ( COMMA expr )* )? RPAR )?
-
-ID
-ID LPAR RPAR
-ID LPAR EXPR RPAR
-ID LPAR EXPR (COMMA EXPR)* RPAR
-*/
-
-// ! TODO: implement types analyzer for factor function
-
-bool factor()
+ *		| REAL
+ *		| STR
+ *		| LPAR expr RPAR
+ *		| ID ( LPAR ( expr ( COMMA expr )* )? RPAR )?
+ */
+int factor(Compiler *c)
 {
-	printf("\n-============ factor ===============-\n\n");
-
-	int start = iTk;
-
-	if (consume(LPAR))
-	{
-		Text_write(crtCode, "(");
-		{
-			if (consume(RPAR))
-			{
-				Text_write(crtCode, ")");
-				printf("\n-============ end factor ===============-\n\n");
-				return true;
-			}
-		}
-	}
-
-	if (consume(ID))
-	{
-		Symbol *s = searchSymbol(consumed->text);
-		if (!s)
-			tkerr("undefined symbol: %s", consumed->text);
-
-		Text_write(crtCode, "%s", s->name);
-
-		if (consume(LPAR))
-		{
-			if (s->kind != KIND_FN)
-				tkerr("%s cannot be called, because it is not a function", s->name);
-			Symbol *argDef = s->args;
-
-			Text_write(crtCode, "(");
-
-			if (expr())
-			{
-				if (!argDef)
-					tkerr("the function %s is called with too many arguments", s->name);
-				if (argDef->type != ret.type)
-					tkerr("the argument type at function %s call is different from the one given at its definition", s->name);
-				argDef = argDef->next;
-
-				while (consume(COMMA))
-				{
-					Text_write(crtCode, ",");
-
-					if (expr())
-					{
-						if (!argDef)
-							tkerr("the function %s is called with too many arguments", s->name);
-						if (argDef->type != ret.type)
-							tkerr("the argument type at function %s call is different from the one given at its definition", s->name);
-						argDef = argDef->next;
-					}
-					else
-					{
-						printf("iTk = %d\n", iTk);
-						tkerr("missing expr after ','\n");
-					}
-				}
-
-				if (expr())
-				{
-					printf("iTk = %d\n", iTk - 1);
-					tkerr("missing token ','\n");
-				}
-
-				if (consume(RPAR))
-				{
-					if (argDef)
-						tkerr("the function %s is called with too few arguments", s->name);
-					setRet(s->type, false);
-					Text_write(crtCode, ")");
-					printf("\n-============ end factor ===============-\n\n");
-					return true;
-				}
-				else
-				{
-					if (s->kind == KIND_FN)
-						tkerr("the function %s can only be called", s->name);
-					setRet(s->type, true);
-
-					printf("iTk = %d\n", iTk);
-					tkerr("missing token ')', after expr\n");
-				}
-			}
-
-			if (consume(RPAR))
-			{
-				if (argDef)
-					tkerr("the function %s is called with too few arguments", s->name);
-				setRet(s->type, false);
-				Text_write(crtCode, ")");
-				printf("\n-============ end factor ===============-\n\n");
-				return true;
-			}
-			else
-			{
-				if (s->kind == KIND_FN)
-					tkerr("the function %s can only be called", s->name);
-				setRet(s->type, true);
-			}
-		}
-
-		printf("\n-============ end factor ===============-\n\n");
-		return true;
-	}
-
-	if (consume(INT))
-	{
-		setRet(TYPE_INT, false);
-		ILOG("[AT] assign int '%d' as a right operand.\n", tokens[iTk].i);
-		Text_write(crtCode, "%d", consumed->i);
-		printf("\n-============ end factor ===============-\n\n");
-		return true;
-	}
-
-	if (consume(REAL))
-	{
-		setRet(TYPE_REAL, false);
-		ILOG("[AT] assign real '%f' as a right operand.\n", tokens[iTk].r);
-		Text_write(crtCode, "%g", consumed->r);
-		printf("\n-============ end factor ===============-\n\n");
-		return true;
-	}
-
-	if (consume(STR))
-	{
-		setRet(TYPE_STR, false);
-		ILOG("[AT] assign str '%s' as a right operand.\n", tokens[iTk].text);
-		Text_write(crtCode, "\"%s\"", consumed->text);
-		printf("\n-============ end factor ===============-\n\n");
-		return true;
-	}
-
-	iTk = start;
-	printf("\n-============ end factor ===============-\n\n");
-	return false;
+	TRACE_ENTER();
+
+	int node = NO_NODE;
+	switch (tkCode(&c->tokens, c->iTk))
+	{
+	case INT:
+		consume(c, INT);
+		node = addNode(&c->ast, N_INT, tkLine(&c->tokens, c->consumed));
+		NODE(&c->ast, node)->val.i = tkInt(&c->tokens, c->consumed);
+		break;
+
+	case REAL:
+		consume(c, REAL);
+		node = addNode(&c->ast, N_REAL, tkLine(&c->tokens, c->consumed));
+		NODE(&c->ast, node)->val.r = tkReal(&c->tokens, c->consumed);
+		break;
+
+	case STR:
+		consume(c, STR);
+		node = addNode(&c->ast, N_STR, tkLine(&c->tokens, c->consumed));
+		NODE(&c->ast, node)->val.id = tkId(&c->tokens, c->consumed);
+		break;
+
+	case LPAR:
+		consume(c, LPAR);
+		if (!lookahead(c, FIRST_EXPR))
+			tkerr(c, "missing expr after '('\n");
+		node = expr(c); // the parentheses are put back by the code generation, where needed
+		if (!consume(c, RPAR))
+			tkerr(c, "missing token ')', after expr\n");
+		break;
+
+	case ID:
+		consume(c, ID);
+		node = addNode(&c->ast, N_ID, tkLine(&c->tokens, c->consumed));
+		NODE(&c->ast, node)->val.id = tkId(&c->tokens, c->consumed);
+		if (consume(c, LPAR))
+		{
+			NODE(&c->ast, node)->kind = N_CALL;
+			int first = NO_NODE, last = NO_NODE;
+			if (lookahead(c, FIRST_EXPR))
+			{
+				do
+				{
+					int arg = expr(c);
+					appendNode(&c->ast, &first, &last, arg);
+				} while (consume(c, COMMA));
+				if (lookahead(c, FIRST_EXPR))
+					tkerr(c, "missing token ','\n");
+			}
+			NODE(&c->ast, node)->a = first;
+			if (!consume(c, RPAR))
+				tkerr(c, "missing token ')', after expr\n");
+		}
+		break;
+
+	default:
+		tkerr(c, "unexpected token '%s', waiting for an expression", tkText(&c->tokens, c->iTk));
+	}
+
+	TRACE_EXIT();
+	return node;
 }
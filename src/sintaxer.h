@@ -6,7 +6,14 @@
 
 #pragma once
 
-void parse();
+typedef struct Compiler Compiler;
+
+// parses the tokens of the compiler and generates the C code for them
+void parse(Compiler *c);
+
+// parses a function definition, beginning with the current token (FUNCTION), and returns its node
+// it is used to compile later the bodies skipped by parse (see Compiler.parallelFns)
+int defFunc(Compiler *c);
 
 // This is a cheatsheet for doxygen
 
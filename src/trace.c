@@ -0,0 +1,52 @@
+#include "trace.h"
+#include "lexer.h"
+
+int traceLevel = TRACE_OFF;
+
+// every thread has its own records, so the compilations which run at the same time do not mix their traces
+static _Thread_local TraceRec ring[TRACE_RING];
+static _Thread_local unsigned nRecs; // the number of added records, including the overwritten ones
+
+void traceAdd(int kind, const char *rule, int line, int code, int found)
+{
+	TraceRec *r = &ring[nRecs++ & (TRACE_RING - 1)];
+	r->rule = rule;
+	r->line = line;
+	r->kind = kind;
+	r->code = code;
+	r->found = found;
+}
+
+void traceDump(FILE *out)
+{
+	unsigned first = 0;
+	if (nRecs > TRACE_RING)
+	{
+		first = nRecs - TRACE_RING;
+		fprintf(out, "... %u older trace records were overwritten\n", first);
+	}
+	int depth = 0;
+	for (unsigned i = first; i < nRecs; i++)
+	{
+		TraceRec *r = &ring[i & (TRACE_RING - 1)];
+		switch (r->kind)
+		{
+		case TR_ENTER:
+			fprintf(out, "%5d %*s%s\n", r->line, 2 * depth, "", r->rule);
+			depth++;
+			break;
+		case TR_EXIT:
+			if (depth > 0)
+				depth--;
+			fprintf(out, "%5d %*send %s\n", r->line, 2 * depth, "", r->rule);
+			break;
+		case TR_CONSUME:
+			fprintf(out, "%5d %*sconsume(%s)\n", r->line, 2 * depth, "", ATOMS_CODE_NAME[r->code]);
+			break;
+		case TR_MISS:
+			fprintf(out, "%5d %*sconsume(%s) => found %s\n", r->line, 2 * depth, "", ATOMS_CODE_NAME[r->code], ATOMS_CODE_NAME[r->found]);
+			break;
+		}
+	}
+	nRecs = 0;
+}
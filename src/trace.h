@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdio.h>
+
+// Tracing of the parser, for debugging.
+// The trace points of a level are compiled only if the level is <= TRACE_MAX
+// (build with "make TRACE_MAX=0" to remove all of them) and they are active only
+// if the level is <= traceLevel, which is set at runtime ("--trace N").
+// An active trace point only adds a small binary record to a ring buffer, which keeps
+// the last TRACE_RING records. The records are decoded to text only by traceDump.
+
+enum
+{
+	TRACE_OFF,
+	TRACE_RULES, // entering and leaving the syntactic rules
+	TRACE_TOKENS // also the consumed tokens
+};
+
+#ifndef TRACE_MAX
+#define TRACE_MAX TRACE_TOKENS
+#endif
+
+#define TRACE_RING 4096 // the number of records kept, a power of 2
+
+enum
+{
+	TR_ENTER,	// a rule begins
+	TR_EXIT,	// a rule ends
+	TR_CONSUME, // a token was consumed
+	TR_MISS		// consume was called for another token than the current one
+};
+
+typedef struct
+{
+	const char *rule;	 // for TR_ENTER, TR_EXIT: the rule name, which must be a string literal
+	int line;			 // the line in the source
+	unsigned char kind;	 // TR_*
+	unsigned char code;	 // for TR_CONSUME, TR_MISS: the code of the expected token
+	unsigned char found; // for TR_MISS: the code of the current token
+} TraceRec;
+
+extern int traceLevel; // TRACE_*, TRACE_OFF by default
+
+// adds a record to the ring buffer
+void traceAdd(int kind, const char *rule, int line, int code, int found);
+
+// writes the records from the ring buffer as text, from the oldest one, and empties the buffer
+void traceDump(FILE *out);
+
+// a trace point for the given level
+// when the level is not active, only traceLevel is tested, and the arguments are not evaluated
+#define TRACE(level, kind, rule, line, code, found)                    \
+	do                                                                 \
+	{                                                                  \
+		if ((level) <= TRACE_MAX && (level) <= traceLevel)             \
+			traceAdd((kind), (rule), (line), (code), (found));         \
+	} while (0)
@@ -1,20 +1,29 @@
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "utils.h"
 
-char *getCurrentDateTime()
+bool logInfo;
+
+const char *getCurrentDateTime()
 {
-	char *currentTime = (char *)malloc(sizeof(char) * 64);
+	// a static buffer for every thread, so the long running processes (see server.h) do not leak memory at every log
+	static _Thread_local char currentTime[64];
 	time_t now;
-	struct tm *local;
+	struct tm local; // localtime_r, because the compilations can run on several threads
 
 	now = time(NULL);
-	local = localtime(&now);
+	localtime_r(&now, &local);
 
-	strftime(currentTime, 64, "%d.%m.%Y %H:%M:%S", local);
+	strftime(currentTime, 64, "%d.%m.%Y %H:%M:%S", &local);
 
 	return currentTime;
 }
@@ -54,3 +63,133 @@ char *loadFile(const char *fileName)
 	buf[n] = '\0';
 	return buf;
 }
+
+
+// the mapped size for a file of n bytes: it is rounded up to whole pages and
+// there is always at least one byte after the content, so the buffer is \0 ended
+static size_t mappedSize(size_t n)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	return (n / page + 1) * page;
+}
+
+const char *tryMapFile(const char *fileName, size_t *size)
+{
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	if (fstat(fd, &st) < 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	size_t n = (size_t)st.st_size;
+	// reserves zero filled pages for the whole buffer, then maps the file over them
+	// this way, if the file ends exactly at a page boundary, the next page provides the \0
+	char *buf = (char *)mmap(NULL, mappedSize(n), PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED)
+		err("not enough memory to map %s", fileName);
+	if (n > 0 && mmap(buf, n, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+	{
+		munmap(buf, mappedSize(n));
+		close(fd);
+		return NULL;
+	}
+	close(fd);
+	madvise(buf, n, MADV_SEQUENTIAL);
+	*size = n;
+	return buf;
+}
+
+const char *mapFile(const char *fileName, size_t *size)
+{
+	const char *buf = tryMapFile(fileName, size);
+	if (!buf)
+		err("unable to map %s", fileName);
+	return buf;
+}
+
+void unmapFile(const char *buf, size_t size)
+{
+	munmap((void *)buf, mappedSize(size));
+}
+
+bool writeAll(int fd, const char *buf, size_t n)
+{
+	while (n)
+	{
+		ssize_t k = write(fd, buf, n);
+		if (k < 0 && errno == EINTR)
+			continue;
+		if (k <= 0)
+			return false;
+		buf += k;
+		n -= k;
+	}
+	return true;
+}
+// ********************* hashing *******************
+
+#define P1 0x9E3779B185EBCA87ull
+#define P2 0xC2B2AE3D27D4EB4Full
+
+// used if the executable cannot be read, so the hashes still change with the version
+#define QUICK_VERSION "quick-1"
+
+static inline uint64_t rotl(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fmix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDull;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+void hashInit(uint64_t h[2])
+{
+	h[0] = P1;
+	h[1] = P2;
+}
+
+void hashBytes(uint64_t h[2], const void *p, size_t n)
+{
+	const unsigned char *b = (const unsigned char *)p;
+	uint64_t w;
+	for (; n >= 8; b += 8, n -= 8)
+	{
+		memcpy(&w, b, 8);
+		h[0] = rotl(h[0] ^ (w * P1), 31) * P2;
+		h[1] = rotl(h[1] + (w * P2), 27) * P1 + h[0];
+	}
+	w = 0;
+	memcpy(&w, b, n);
+	h[0] = rotl(h[0] ^ (w * P1), 31) * P2;
+	h[1] = rotl(h[1] + (w * P2), 27) * P1 + h[0];
+}
+
+void hashExe(uint64_t h[2])
+{
+	size_t size;
+	const char *exe = tryMapFile("/proc/self/exe", &size);
+	if (exe)
+	{
+		hashBytes(h, exe, size);
+		unmapFile(exe, size);
+	}
+	else
+	{
+		hashBytes(h, QUICK_VERSION, sizeof(QUICK_VERSION));
+	}
+}
+
+void hashHex(const uint64_t h[2], char *hex)
+{
+	snprintf(hex, HASH_HEX_LEN + 1, "%016llx%016llx", (unsigned long long)fmix(h[0]), (unsigned long long)fmix(h[1] ^ h[0]));
+}
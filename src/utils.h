@@ -14,12 +14,20 @@
 #define ERROR "\033[1;49;91mERROR\033[0m"
 #endif
 
-#define ILOG(fmt, ...) fprintf(stdout, "[" INFO "][%s] %s:%d - " fmt, getCurrentDateTime(), __FILE__, __LINE__, ##__VA_ARGS__)
+// the info messages are shown only if logInfo is true ("--log"), the error messages always
+#define ILOG(fmt, ...)                                                                                                \
+	do                                                                                                                \
+	{                                                                                                                 \
+		if (logInfo)                                                                                                  \
+			fprintf(stdout, "[" INFO "][%s] %s:%d - " fmt, getCurrentDateTime(), __FILE__, __LINE__, ##__VA_ARGS__); \
+	} while (0)
 #define ELOG(fmt, ...) fprintf(stdout, "[" ERROR "][%s] %s:%d - " fmt, getCurrentDateTime(), __FILE__, __LINE__, ##__VA_ARGS__)
 
 // ********************* logging message *******************
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 // prints to stderr a message prefixed with "error: " and exit the program
 // the arguments are the same as for printf
@@ -33,7 +41,42 @@ void *safeAlloc(size_t nBytes);
 // on error, prints a message and exit the program
 char *loadFile(const char *fileName);
 
-// get the current date and time as a string
-char *getCurrentDateTime();
+// maps a text file in memory, read only, and returns its content, followed by at least one \0
+// the content is not copied, so the memory used for it is shared with the OS page cache
+// sets *size to the size of the file
+// on error, prints a message and exit the program
+const char *mapFile(const char *fileName, size_t *size);
+
+// same as mapFile, but on error returns NULL, with the cause in errno
+const char *tryMapFile(const char *fileName, size_t *size);
+
+// unmaps a file mapped with mapFile
+void unmapFile(const char *buf, size_t size);
+
+// writes n chars to the file descriptor fd, continuing after the partial and interrupted writes
+// returns false on error
+bool writeAll(int fd, const char *buf, size_t n);
+
+// ********************* hashing *******************
+
+#define HASH_HEX_LEN 32 // the hex digits of a hash
+
+// begins a 128 bits hash
+void hashInit(uint64_t h[2]);
+
+// adds n bytes to a hash, reading 8 bytes at a time; it is fast, but not cryptographic
+void hashBytes(uint64_t h[2], const void *p, size_t n);
+
+// adds the transpiler executable to a hash, so the hash changes with any change of the transpiler
+void hashExe(uint64_t h[2]);
+
+// writes the final value of a hash in hex, in HASH_HEX_LEN+1 chars
+void hashHex(const uint64_t h[2], char *hex);
+
+// returns the current date and time as text, in a buffer of the calling thread, reused by the next call
+const char *getCurrentDateTime();
+
+// if true, ILOG shows its messages
+extern bool logInfo;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+// Generates the keywords recognizer used by tokenize.
+// It searches a perfect hash function for the KEYWORDS list from lexer.h,
+// keyed on the length, the first and the last char of a word:
+//		h = (len * A + first * B + last * C) & (SIZE - 1)
+// and prints on stdout a table indexed by h, so an identifier is classified
+// with a single lookup and one memcmp, without copying it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "../src/lexer.h"
+
+typedef struct
+{
+	const char *text;
+	int code;
+	const char *codeName;
+} Keyword;
+
+#define KEYWORD(text, code) {text, code, #code},
+const Keyword keywords[] = {KEYWORDS(KEYWORD)};
+#define N_KEYWORDS ((int)(sizeof(keywords) / sizeof(keywords[0])))
+
+int hash(const char *text, int a, int b, int c, int size)
+{
+	size_t len = strlen(text);
+	return (int)((len * a + (unsigned char)text[0] * b + (unsigned char)text[len - 1] * c) & (size - 1));
+}
+
+// returns true if the params a, b, c give distinct slots for all the keywords
+bool isPerfect(int a, int b, int c, int size)
+{
+	bool used[256] = {false};
+	for (int i = 0; i < N_KEYWORDS; i++)
+	{
+		int h = hash(keywords[i].text, a, b, c, size);
+		if (used[h])
+			return false;
+		used[h] = true;
+	}
+	return true;
+}
+
+int main()
+{
+	int maxLen = 0;
+	for (int i = 0; i < N_KEYWORDS; i++)
+	{
+		int len = (int)strlen(keywords[i].text);
+		if (len > maxLen)
+			maxLen = len;
+	}
+
+	// the smallest table is preferred, then the smallest multipliers
+	for (int size = 16; size <= 256; size *= 2)
+	{
+		for (int a = 0; a < 32; a++)
+		{
+			for (int b = 1; b < 32; b++)
+			{
+				for (int c = 0; c < 32; c++)
+				{
+					if (!isPerfect(a, b, c, size))
+						continue;
+
+					const Keyword *slots[256] = {NULL};
+					for (int i = 0; i < N_KEYWORDS; i++)
+						slots[hash(keywords[i].text, a, b, c, size)] = &keywords[i];
+
+					printf("// generated by tools/kwgen.c from KEYWORDS in lexer.h - do not edit\n\n");
+					printf("#define KW_MAX_LEN %d\n\n", maxLen);
+					printf("// the slot of a word in kwTable, from its length, first and last char\n");
+					printf("#define KW_HASH(len, first, last) ((((size_t)(len)) * %d + ((unsigned char)(first)) * %d + ((unsigned char)(last)) * %d) & %d)\n\n", a, b, c, size - 1);
+					printf("static const struct\n{\n\tunsigned char len; // 0 for an empty slot\n\tunsigned char code;\n\tchar text[KW_MAX_LEN + 1];\n} kwTable[%d] = {\n", size);
+					for (int h = 0; h < size; h++)
+					{
+						if (slots[h])
+							printf("\t[%d] = {%d, %s, \"%s\"},\n", h, (int)strlen(slots[h]->text), slots[h]->codeName, slots[h]->text);
+					}
+					printf("};\n");
+					return 0;
+				}
+			}
+		}
+	}
+	fprintf(stderr, "error: cannot find a perfect hash for the keywords\n");
+	return EXIT_FAILURE;
+}
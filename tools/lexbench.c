@@ -0,0 +1,243 @@
+// Lexing benchmark: tokenizes generated Quick sources with every scanner
+// available on this CPU and reports the throughput in MB/s.
+// The "mixed" source is like a hand written program, the "numeric" one is
+// a large table of constants, where most of the time goes in numbers parsing.
+// For the numeric source, the lexing is also compared with the numbers parsing done
+// before the fused lexNumber: scan the digits, copy them and parse them again with atoi/atof.
+// usage: lexbench [source.q]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ctype.h>
+
+#include "../src/lexer.h"
+#include "../src/scan.h"
+#include "../src/pool.h"
+#include "../src/utils.h"
+
+#define BENCH_SIZE (64 * 1024 * 1024)
+#define BENCH_RUNS 3
+
+// generates a source of the given size by repeating chunk
+char *genRepeated(const char *chunk, size_t size)
+{
+	size_t len = strlen(chunk);
+	char *buf = (char *)safeAlloc(size + 1);
+	size_t n = 0;
+	while (n + len <= size)
+	{
+		memcpy(buf + n, chunk, len);
+		n += len;
+	}
+	buf[n] = '\0';
+	return buf;
+}
+
+// generates a source with long identifiers, comments and indentation
+char *genMixed(size_t size)
+{
+	static const char *chunk =
+		 "# computes the sum of the first elements from a generated table\n"
+		 "function accumulate_values_from_table(current_index:int, partial_sum_value:real):real\n"
+		 "        var temporary_value_holder: real;\n"
+		 "        while (current_index < 1000000)\n"
+		 "                temporary_value_holder = partial_sum_value * 3.14159265;   # scale\n"
+		 "                current_index = current_index + 1;\n"
+		 "        end\n"
+		 "        return temporary_value_holder;\n"
+		 "end\n"
+		 "puts(\"accumulated value of the table\");\n\n";
+	return genRepeated(chunk, size);
+}
+
+// generates a table of int and real constants
+char *genNumeric(size_t size)
+{
+	static const char *chunk =
+		 "t = 1234567 + 3.14159265358979 * 2718281 - 0.000123456789 + 1.5;\n"
+		 "t = 987654321 + 6.02214076 * 1000000007 - 299792458.0 + 42;\n";
+	return genRepeated(chunk, size);
+}
+
+// the tokens list and the interned strings, reused by all the runs
+Tokens tks;
+Interner strings;
+
+// tokenizes src in tks, serially or in parallel
+void lex(const char *src, size_t size, int nThreads)
+{
+	Lexer lx;
+	lexerInit(&lx, &tks, &strings, src);
+	if (nThreads > 1)
+		tokenizeParallel(&lx, size, nThreads);
+	else
+		tokenize(&lx);
+}
+
+double seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// tokenizes src with every available scanner and prints the throughput
+void bench(const char *title, const char *src)
+{
+	size_t size = strlen(src);
+	const char *names[] = {"scalar", "sse2", "avx2"};
+	int nTokensScalar = -1;
+
+	printf("%s input: %.1f MB\n", title, size / 1e6);
+	for (int i = 0; i < 3; i++)
+	{
+		if (!scanUse(names[i]))
+		{
+			printf("  %-8s not available\n", names[i]);
+			continue;
+		}
+		double best = 0;
+		for (int run = 0; run < BENCH_RUNS; run++)
+		{
+			double t = seconds();
+			lex(src, size, 1);
+			t = seconds() - t;
+			if (best == 0 || t < best)
+				best = t;
+		}
+		if (nTokensScalar < 0)
+			nTokensScalar = tks.n;
+		else if (tks.n != nTokensScalar)
+			err("%s produced %d tokens instead of %d", names[i], tks.n, nTokensScalar);
+		printf("  %-8s %8.1f MB/s  (%d tokens)\n", names[i], size / 1e6 / best, tks.n);
+	}
+
+	// the parallel lexing, with the best scanner, must give the same tokens as the serial one
+	scanInit();
+	lex(src, size, 1);
+	int n = tks.n;
+	unsigned char *codes = (unsigned char *)safeAlloc(n);
+	int *lines = (int *)safeAlloc(n * sizeof(int));
+	memcpy(codes, tks.code, n);
+	memcpy(lines, tks.line, n * sizeof(int));
+	int nThreads = nCores();
+	double best = 0;
+	for (int run = 0; run < BENCH_RUNS; run++)
+	{
+		double t = seconds();
+		lex(src, size, nThreads);
+		t = seconds() - t;
+		if (best == 0 || t < best)
+			best = t;
+	}
+	if (tks.n != n || memcmp(codes, tks.code, n) || memcmp(lines, tks.line, n * sizeof(int)))
+		err("the parallel lexing produced other tokens than the serial one");
+	printf("  %-8s %8.1f MB/s  (%d tokens, %s, %d threads)\n", "parallel", size / 1e6 / best, tks.n, scanner->name, nThreads);
+	free(codes);
+	free(lines);
+}
+
+// parses all the numbers from src like the old tokenize: scans them, copies them in a buffer
+// and converts them with atoi/atof; if check is true, compares them with the tokens values
+// returns the number of parsed numbers
+int oldNumbers(const char *src, bool check)
+{
+	char buf[64];
+	int n = 0, tk = 0;
+	for (const char *p = src; *p;)
+	{
+		if (isalpha((unsigned char)*p) || *p == '_')
+		{
+			while (isalnum((unsigned char)*p) || *p == '_')
+				p++;
+			continue;
+		}
+		if (!isdigit((unsigned char)*p))
+		{
+			p++;
+			continue;
+		}
+		const char *begin = p;
+		while (isdigit((unsigned char)*p))
+			p++;
+		bool real = *p == '.';
+		if (real)
+		{
+			for (p++; isdigit((unsigned char)*p); p++)
+			{
+			}
+		}
+		size_t len = (size_t)(p - begin) < sizeof(buf) ? (size_t)(p - begin) : sizeof(buf) - 1;
+		memcpy(buf, begin, len);
+		buf[len] = '\0';
+		if (check)
+		{
+			while (tks.code[tk] != INT && tks.code[tk] != REAL)
+				tk++;
+			if (real ? tks.code[tk] != REAL || tks.val[tk].r != atof(buf) : tks.code[tk] != INT || tks.val[tk].i != atoi(buf))
+				err("the lexer value of %s differs from atoi/atof", buf);
+			tk++;
+		}
+		else if (real)
+		{
+			volatile double r = atof(buf);
+			(void)r;
+		}
+		else
+		{
+			volatile int i = atoi(buf);
+			(void)i;
+		}
+		n++;
+	}
+	return n;
+}
+
+// compares the whole lexing of src with only the numbers parsing of the old tokenize
+void benchNumbers(const char *src)
+{
+	size_t size = strlen(src);
+	scanInit();
+	double best = 0;
+	for (int run = 0; run < BENCH_RUNS; run++)
+	{
+		double t = seconds();
+		lex(src, size, 1);
+		t = seconds() - t;
+		if (best == 0 || t < best)
+			best = t;
+	}
+	int n = oldNumbers(src, true);
+	double bestOld = 0;
+	for (int run = 0; run < BENCH_RUNS; run++)
+	{
+		double t = seconds();
+		oldNumbers(src, false);
+		t = seconds() - t;
+		if (bestOld == 0 || t < bestOld)
+			bestOld = t;
+	}
+	printf("  %-8s %8.1f MB/s  (all the tokens, with the fused number parsing)\n", "lexing", size / 1e6 / best);
+	printf("  %-8s %8.1f MB/s  (only the %d numbers, copied and parsed with atoi/atof)\n", "old", size / 1e6 / bestOld, n);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc > 1)
+	{
+		char *src = loadFile(argv[1]);
+		bench(argv[1], src);
+		free(src);
+		return 0;
+	}
+	char *src = genMixed(BENCH_SIZE);
+	bench("mixed", src);
+	free(src);
+	src = genNumeric(BENCH_SIZE);
+	bench("numeric", src);
+	benchNumbers(src);
+	free(src);
+	return 0;
+}
@@ -0,0 +1,122 @@
+// Generates the scanner for delimiters and operators used by tokenize.
+// From the spellings given in ATOMS in lexer.h, it builds a DFA where every state is a prefix
+// of some spelling, and prints on stdout its byte-indexed transition table.
+// The scanner follows the transitions as long as they exist (longest match),
+// then the state where it stopped gives the recognized atom.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/lexer.h"
+
+typedef struct
+{
+	int code;
+	const char *codeName;
+	const char *spelling;
+} Op;
+
+#define ATOM_OP(code, spelling) {code, #code, spelling},
+const Op atoms[] = {ATOMS(ATOM_OP)};
+#define N_ATOMS ((int)(sizeof(atoms) / sizeof(atoms[0])))
+
+#define MAX_STATES 256
+#define MAX_SPELLING 8
+
+char prefixes[MAX_STATES][MAX_SPELLING + 1]; // the prefix for every state, state 0 is ""
+int nStates = 1;
+int next[MAX_STATES][256];
+int accept[MAX_STATES];
+
+int stateOf(const char *prefix, size_t len)
+{
+	for (int s = 0; s < nStates; s++)
+	{
+		if (strlen(prefixes[s]) == len && !strncmp(prefixes[s], prefix, len))
+			return s;
+	}
+	if (nStates == MAX_STATES)
+	{
+		fprintf(stderr, "error: too many states\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(prefixes[nStates], prefix, len);
+	prefixes[nStates][len] = '\0';
+	accept[nStates] = -1;
+	return nStates++;
+}
+
+// prints ch as a C char constant
+void printChar(int ch)
+{
+	if (ch == '\'' || ch == '\\')
+		printf("'\\%c'", ch);
+	else if (ch > ' ' && ch < 127)
+		printf("'%c'", ch);
+	else
+		printf("%d", ch);
+}
+
+int main()
+{
+	accept[0] = -1;
+	for (int i = 0; i < N_ATOMS; i++)
+	{
+		const char *sp = atoms[i].spelling;
+		if (!sp)
+			continue;
+		size_t len = strlen(sp);
+		if (len == 0 || len > MAX_SPELLING)
+		{
+			fprintf(stderr, "error: invalid spelling for %s\n", atoms[i].codeName);
+			return EXIT_FAILURE;
+		}
+		int s = 0;
+		for (size_t k = 1; k <= len; k++)
+		{
+			int t = stateOf(sp, k);
+			next[s][(unsigned char)sp[k - 1]] = t;
+			s = t;
+		}
+		if (accept[s] >= 0)
+		{
+			fprintf(stderr, "error: %s and %s have the same spelling\n", atoms[accept[s]].codeName, atoms[i].codeName);
+			return EXIT_FAILURE;
+		}
+		accept[s] = i;
+	}
+
+	printf("// generated by tools/opgen.c from ATOMS in lexer.h - do not edit\n\n");
+	printf("#define OP_STATES %d\n\n", nStates);
+	printf("// opNext[s][ch]: the state after ch from the state s or 0 if ch does not continue a delimiter or operator\n");
+	printf("static const unsigned char opNext[OP_STATES][256] = {\n");
+	for (int s = 0; s < nStates; s++)
+	{
+		printf("\t[%d] = {", s);
+		const char *sep = "";
+		for (int ch = 0; ch < 256; ch++)
+		{
+			if (next[s][ch])
+			{
+				printf("%s[", sep);
+				printChar(ch);
+				printf("] = %d", next[s][ch]);
+				sep = ", ";
+			}
+		}
+		printf("}, // \"%s\"\n", prefixes[s]);
+	}
+	printf("};\n\n");
+	printf("// opAccept[s]: the atom recognized when the scanner stops in the state s or -1 if no atom ends there\n");
+	printf("static const signed char opAccept[OP_STATES] = {\n");
+	for (int s = 0; s < nStates; s++)
+	{
+		if (accept[s] >= 0)
+			printf("\t[%d] = %s,\n", s, atoms[accept[s]].codeName);
+		else
+			printf("\t[%d] = -1,\n", s);
+	}
+	printf("};\n");
+	return 0;
+}
@@ -0,0 +1,230 @@
+// Generates the prelude: the table with the symbols of the predefined functions.
+// It reads the function headers from a Quick file, ex: src/prelude.q:
+//		function name(arg:type, ...):type
+// where # begins a comment until the end of the line, and prints on stdout
+// the names to be interned, with their lengths and hashes, and the read-only symbols, as C initializers.
+// The functions are first in the names, so the id of a function is its index in preludeFns.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "../src/lexer.h"
+
+typedef struct
+{
+	const char *text;
+	int code;
+	const char *codeName;
+} Keyword;
+
+#define KEYWORD(text, code) {text, code, #code},
+const Keyword keywords[] = {KEYWORDS(KEYWORD)};
+#define N_KEYWORDS ((int)(sizeof(keywords) / sizeof(keywords[0])))
+
+#define MAX_FNS 1024
+#define MAX_ARGS 64
+#define MAX_NAMES (MAX_FNS * (MAX_ARGS + 1))
+#define MAX_WORD 64
+
+typedef struct
+{
+	char text[MAX_WORD]; // its name, added after all the function names
+	int name;
+	const char *type;
+} Arg;
+
+typedef struct
+{
+	int name;
+	const char *type;
+	Arg args[MAX_ARGS];
+	int nArgs;
+} Fn;
+
+Fn fns[MAX_FNS];
+int nFns;
+char names[MAX_NAMES][MAX_WORD];
+int nNames;
+
+const char *fileName;
+FILE *fis;
+int line = 1;
+
+void fail(const char *msg, const char *word)
+{
+	fprintf(stderr, "%s:%d: error: %s%s\n", fileName, line, msg, word);
+	exit(EXIT_FAILURE);
+}
+
+// skips the spaces and the comments and returns the next char, without consuming it
+int peek()
+{
+	for (;;)
+	{
+		int ch = getc(fis);
+		if (ch == '#')
+		{
+			while (ch != '\n' && ch != EOF)
+				ch = getc(fis);
+		}
+		if (ch == '\n')
+			line++;
+		if (ch == EOF || !isspace(ch))
+		{
+			ungetc(ch, fis);
+			return ch;
+		}
+	}
+}
+
+void expect(char delimiter)
+{
+	char text[2] = {delimiter, '\0'};
+	if (peek() != delimiter)
+		fail("missing ", text);
+	getc(fis);
+}
+
+void word(char *w)
+{
+	int n = 0;
+	int ch = peek();
+	if (!isalpha(ch) && ch != '_')
+		fail("missing a name", "");
+	while (isalnum(ch) || ch == '_')
+	{
+		if (n == MAX_WORD - 1)
+			fail("too long name", "");
+		w[n++] = (char)getc(fis);
+		ch = fgetc(fis);
+		ungetc(ch, fis);
+	}
+	w[n] = '\0';
+}
+
+// returns the index of a name, adding it if it is new
+int nameOf(const char *w)
+{
+	for (int i = 0; i < nNames; i++)
+	{
+		if (!strcmp(names[i], w))
+			return i;
+	}
+	if (nNames == MAX_NAMES)
+		fail("too many names", "");
+	strcpy(names[nNames], w);
+	return nNames++;
+}
+
+// returns the code name of a type, ex: "int" -> "TYPE_INT"
+const char *type()
+{
+	char w[MAX_WORD];
+	word(w);
+	for (int i = 0; i < N_KEYWORDS; i++)
+	{
+		if (!strcmp(keywords[i].text, w) && !strncmp(keywords[i].codeName, "TYPE_", 5))
+			return keywords[i].codeName;
+	}
+	fail("unknown type: ", w);
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2)
+	{
+		fprintf(stderr, "usage: prelgen prelude.q\n");
+		return EXIT_FAILURE;
+	}
+	fileName = argv[1];
+	if (!(fis = fopen(fileName, "r")))
+	{
+		perror(fileName);
+		return EXIT_FAILURE;
+	}
+	char w[MAX_WORD];
+	while (peek() != EOF)
+	{
+		word(w);
+		if (strcmp(w, "function"))
+			fail("waiting for 'function', found: ", w);
+		if (nFns == MAX_FNS)
+			fail("too many functions", "");
+		Fn *fn = &fns[nFns];
+		word(w);
+		for (int i = 0; i < nFns; i++)
+		{
+			if (!strcmp(names[fns[i].name], w))
+				fail("function redefinition: ", w);
+		}
+		fn->name = nameOf(w);
+		expect('(');
+		if (peek() != ')')
+		{
+			for (;;)
+			{
+				if (fn->nArgs == MAX_ARGS)
+					fail("too many arguments", "");
+				word(fn->args[fn->nArgs].text);
+				expect(':');
+				fn->args[fn->nArgs++].type = type();
+				if (peek() != ',')
+					break;
+				getc(fis);
+			}
+		}
+		expect(')');
+		expect(':');
+		fn->type = type();
+		nFns++;
+	}
+	fclose(fis);
+	if (!nFns)
+		fail("no functions", "");
+	int nArgs = 0;
+	for (int i = 0; i < nFns; i++)
+	{
+		for (int k = 0; k < fns[i].nArgs; k++)
+			fns[i].args[k].name = nameOf(fns[i].args[k].text);
+		nArgs += fns[i].nArgs;
+	}
+
+	printf("// generated by tools/prelgen.c from %s - do not edit\n\n", fileName);
+	printf("#define N_PRELUDE_FNS %d\n", nFns);
+	printf("#define N_PRELUDE_NAMES %d\n\n", nNames);
+	printf("static const char *const preludeNames[N_PRELUDE_NAMES] = {\n");
+	for (int i = 0; i < nNames; i++)
+		printf("\t\"%s\",\n", names[i]);
+	printf("};\n\n");
+	printf("static const size_t preludeLens[N_PRELUDE_NAMES] = {");
+	for (int i = 0; i < nNames; i++)
+		printf("%s%zu", i ? ", " : "", strlen(names[i]));
+	printf("};\n\n");
+	// the hashes of the interner, so the names are added to it without hashing them (see internSeed)
+	printf("static const unsigned preludeHashes[N_PRELUDE_NAMES] = {\n");
+	for (int i = 0; i < nNames; i++)
+		printf("\t%uu,\n", internHashOf(names[i], strlen(names[i])));
+	printf("};\n\n");
+	// an empty array is not valid in C
+	printf("static const Symbol preludeArgs[%d] = {\n", nArgs ? nArgs : 1);
+	for (int i = 0; i < nFns; i++)
+	{
+		for (int k = 0; k < fns[i].nArgs; k++)
+			printf("\t{.name = %d, .kind = KIND_ARG, .type = %s},\n", fns[i].args[k].name, fns[i].args[k].type);
+	}
+	printf("};\n\n");
+	// the symbols are only read, so the const is cast away only to fit the type of Symbol.args
+	printf("static const Symbol preludeFns[N_PRELUDE_FNS] = {\n");
+	for (int i = 0, arg = 0; i < nFns; i++)
+	{
+		printf("\t{.name = %d, .kind = KIND_FN, .type = %s, .args = (Symbol *)&preludeArgs[%d], .nArgs = %d, .order = -1},\n",
+			   fns[i].name, fns[i].type, arg, fns[i].nArgs);
+		arg += fns[i].nArgs;
+	}
+	printf("};\n");
+	return EXIT_SUCCESS;
+}